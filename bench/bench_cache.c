@@ -0,0 +1,118 @@
+// Cache kernel benchmark: translates a trace once, then replays the
+// PhysRecords through cache_sim_replay() for every associativity of one
+// cache size and reports block accesses per second.
+//
+// usage: bench_cache [trace|random|hits] [reps] [cacheKB] [blocksize] [policy]
+//   random replays a uniform stream over twice the cache size instead, so
+//   the tag store no longer fits in the host caches.
+//   hits replays a uniform stream over exactly the cache size: after the
+//   warm-up pass every access hits, which isolates the way lookup.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cachesim.h"
+#include "pagetable.h"
+#include "pipeline.h"
+#include "trace.h"
+
+static PhysRecord* load_phys(const char* path, size_t* count) {
+    TraceReader tr;
+    if (!trace_open(&tr, path)) {
+        fprintf(stderr, "Error: cannot open %s\n", path);
+        exit(1);
+    }
+    PageTable pt;
+    pt_init(&pt);
+    VmStats vm = {0};
+    vm.free_ppn_left = 1ULL << 20;   // 4GB of frames, no page faults
+
+    size_t n = 0, cap = 1 << 16;
+    PhysRecord* recs = (PhysRecord*)malloc(cap * sizeof(PhysRecord));
+    int seen = 0, done = 0;
+    while (recs && !done) {
+        if (cap - n < 4096) {
+            cap *= 2;
+            recs = (PhysRecord*)realloc(recs, cap * sizeof(PhysRecord));
+            if (!recs) break;
+        }
+        n += vm_translate_batch(&tr, &pt, &vm, -1, &seen, &done, recs + n, 4096);
+    }
+    if (!recs) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    pt_free(&pt);
+    trace_close(&tr);
+    *count = n;
+    return recs;
+}
+
+// xorshift64 stream of 4-byte instructions with a dst access each
+static PhysRecord* random_phys(size_t count, unsigned long long span) {
+    PhysRecord* recs = (PhysRecord*)malloc(count * sizeof(PhysRecord));
+    if (!recs) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    unsigned long long x = 88172645463325252ULL;
+    for (size_t i = 0; i < count; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        recs[i].eip_pa = (uint32_t)((x % span) & ~3ULL);
+        recs[i].dst_pa = (uint32_t)(((x >> 32) % span) & ~3ULL);
+        recs[i].src_pa = 0;
+        recs[i].len = 4;
+        recs[i].flags = PHYS_EIP_MAPPED | PHYS_DST_USED | PHYS_DST_MAPPED;
+        recs[i].reserved = 0;
+        recs[i].eip = recs[i].eip_pa;
+    }
+    return recs;
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = (argc > 1) ? argv[1] : "trace_files/Trace1half.trc";
+    int reps = (argc > 2) ? atoi(argv[2]) : 50;
+    int size_kb = (argc > 3) ? atoi(argv[3]) : 8192;
+    int block = (argc > 4) ? atoi(argv[4]) : 64;
+    ReplacementPolicy policy = POLICY_RR;
+    if (argc > 5 && !cache_policy_parse(argv[5], &policy)) {
+        fprintf(stderr, "Error: unknown policy %s\n", argv[5]);
+        return 1;
+    }
+    if (reps < 1) reps = 1;
+
+    size_t count = 1 << 20;
+    unsigned long long cache_bytes = (unsigned long long)size_kb * 1024ULL;
+    PhysRecord* recs;
+    if (strcmp(path, "random") == 0)
+        recs = random_phys(count, 2ULL * cache_bytes);
+    else if (strcmp(path, "hits") == 0)
+        recs = random_phys(count, cache_bytes);
+    else
+        recs = load_phys(path, &count);
+    printf("Trace:\t%s (%zu instructions x %d reps), %d KB, %d-byte blocks, %s, %s lookup\n",
+           path, count, reps, size_kb, block, cache_policy_name(policy),
+           cache_simd_name());
+    printf("Ways\tAccesses\tHit rate\tTime (s)\tM accesses/s\n");
+
+    for (int ways = 1; ways <= 16; ways *= 2) {
+        CacheSim cs;
+        cache_sim_init(&cs, size_kb, block, ways, policy);
+        cache_sim_replay(&cs, recs, count);   // warm-up, not timed
+        cs.accesses = cs.hits = 0;
+        clock_t start = clock();
+        for (int r = 0; r < reps; r++)
+            cache_sim_replay(&cs, recs, count);
+        double t = (double)(clock() - start) / CLOCKS_PER_SEC;
+        printf("%d\t%llu\t%.4f%%\t%.3f\t\t%.2f\n", ways, cs.accesses,
+               cs.accesses ? 100.0 * cs.hits / cs.accesses : 0.0, t,
+               cs.accesses / (t > 0 ? t : 1e-9) / 1e6);
+        cache_sim_free(&cs);
+    }
+    free(recs);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Page table lookup benchmark: replays the VPN stream of a trace through
+// the old linear-scan lookup and the radix pt_find().
+//
+// usage: bench_pagetable [trace.trc] [reps] [copies]
+//   copies > 1 relocates the trace into that many disjoint VPN ranges of the
+//   same process, to model a process that has touched many more pages.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pagetable.h"
+
+// the original Milestone 2 lookup, kept here as the reference
+static long linear_find(const PageTable* pt, unsigned long long vpn) {
+    for (size_t i = 0; i < pt->used; i++) {
+        if (pt->arr[i].vpn == vpn)
+            return (long)i;
+    }
+    return -1;
+}
+
+static unsigned long long* load_vpns(const char* path, size_t* count) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: cannot open %s\n", path);
+        exit(1);
+    }
+    size_t n = 0, cap = 1024;
+    unsigned long long* v = (unsigned long long*)malloc(cap * sizeof(*v));
+    char line[256];
+    while (v && fgets(line, sizeof(line), fp)) {
+        unsigned long long a[2];
+        int k = 0, len;
+        if (sscanf(line, "EIP (%d): %llx", &len, &a[0]) == 2) {
+            k = 1;
+        } else if (strncmp(line, "dstM:", 5) == 0) {
+            if (sscanf(line, "dstM: %llx", &a[k]) == 1 && a[k]) k++;
+            const char* s = strstr(line, "srcM:");
+            if (s && sscanf(s, "srcM: %llx", &a[k]) == 1 && a[k]) k++;
+        }
+        for (int j = 0; j < k; j++) {
+            if (n == cap) {
+                cap *= 2;
+                v = (unsigned long long*)realloc(v, cap * sizeof(*v));
+                if (!v) break;
+            }
+            if (v) v[n++] = a[j] >> 12;
+        }
+    }
+    fclose(fp);
+    if (!v) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    *count = n;
+    return v;
+}
+
+static double run(const unsigned long long* vpns, size_t n, int reps, int copies,
+                  int radix, unsigned long long* checksum) {
+    PageTable pt;
+    pt_init(&pt);
+    unsigned long long next_ppn = 0, sum = 0;
+    clock_t start = clock();
+    for (int r = 0; r < reps; r++) {
+        for (int c = 0; c < copies; c++) {
+            unsigned long long base = (unsigned long long)c << 8;
+            for (size_t i = 0; i < n; i++) {
+                unsigned long long vpn = (vpns[i] + base) & (VA_PAGES_PER_PROC - 1);
+                long idx = radix ? pt_find(&pt, vpn) : linear_find(&pt, vpn);
+                if (idx < 0) {
+                    pt_push(&pt, vpn, next_ppn++);
+                    idx = (long)pt.used - 1;
+                }
+                sum += pt.arr[idx].ppn;
+            }
+        }
+    }
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    *checksum = sum;
+    pt_free(&pt);
+    return secs;
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = (argc > 1) ? argv[1] : "trace_files/Trace1half.trc";
+    int reps = (argc > 2) ? atoi(argv[2]) : 20;
+    int copies = (argc > 3) ? atoi(argv[3]) : 1;
+    if (reps < 1) reps = 1;
+    if (copies < 1) copies = 1;
+
+    size_t n;
+    unsigned long long* vpns = load_vpns(path, &n);
+    double lookups = (double)n * reps * copies;
+
+    unsigned long long sum_lin, sum_rdx;
+    double t_lin = run(vpns, n, reps, copies, 0, &sum_lin);
+    double t_rdx = run(vpns, n, reps, copies, 1, &sum_rdx);
+
+    printf("Trace:\t\t\t%s (%zu page refs x %d reps x %d copies)\n",
+           path, n, reps, copies);
+    printf("Linear scan:\t\t%.3f s (%.1f M lookups/s)\n",
+           t_lin, lookups / (t_lin > 0 ? t_lin : 1e-9) / 1e6);
+    printf("Radix table:\t\t%.3f s (%.1f M lookups/s)\n",
+           t_rdx, lookups / (t_rdx > 0 ? t_rdx : 1e-9) / 1e6);
+    printf("Speedup:\t\t%.2fx\n", t_lin / (t_rdx > 0 ? t_rdx : 1e-9));
+    if (sum_lin != sum_rdx) {
+        printf("Error: lookup results differ.\n");
+        return 1;
+    }
+    free(vpns);
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Parse-only benchmark: decodes every EIP and dstM/srcM line of a trace
+// with the tolerant parsers and with the fixed-offset fast path, and
+// reports records/second for each. Also checks both agree on every line.
+//
+// usage: bench_parse [trace.trc] [reps]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+typedef struct {
+    const char* p;
+    size_t n;
+} Line;
+
+static char* load_file(const char* path, size_t* size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: cannot open %s\n", path);
+        exit(1);
+    }
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* buf = (char*)malloc((size_t)len + 1);
+    if (!buf || fread(buf, 1, (size_t)len, fp) != (size_t)len) {
+        fprintf(stderr, "Error: cannot read %s\n", path);
+        exit(1);
+    }
+    fclose(fp);
+    *size = (size_t)len;
+    return buf;
+}
+
+static Line* split_lines(const char* buf, size_t size, size_t* count) {
+    size_t n = 0, cap = 1024;
+    Line* lines = (Line*)malloc(cap * sizeof(Line));
+    const char* p = buf;
+    const char* end = buf + size;
+    while (lines && p < end) {
+        const char* nl = (const char*)memchr(p, '\n', (size_t)(end - p));
+        size_t len = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+        if (p[0] != '\n' && p[0] != '\r') {
+            if (n == cap) {
+                cap *= 2;
+                lines = (Line*)realloc(lines, cap * sizeof(Line));
+                if (!lines) break;
+            }
+            lines[n].p = p;
+            lines[n].n = len;
+            n++;
+        }
+        p += len;
+    }
+    if (!lines) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    *count = n;
+    return lines;
+}
+
+static unsigned long long parse_all(const Line* lines, size_t count, int fast,
+                                    size_t* fast_hits) {
+    unsigned long long sum = 0;
+    size_t hits = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned long long a, d, s;
+        int len, dv, sv;
+        const char* p = lines[i].p;
+        size_t n = lines[i].n;
+        if (p[0] == 'E') {
+            if (fast && parse_eip_fast(p, n, &a, &len)) {
+                hits++;
+            } else if (!parse_eip_line(p, n, &a, &len)) {
+                continue;
+            }
+            sum += a + (unsigned long long)len;
+        } else {
+            if (fast && parse_dst_src_fast(p, n, &d, &dv, &s, &sv))
+                hits++;
+            else
+                parse_dst_src_line(p, n, &d, &dv, &s, &sv);
+            sum += (dv ? d : 1) * 3 + (sv ? s : 1);
+        }
+    }
+    *fast_hits = hits;
+    return sum;
+}
+
+// every line the fast path accepts must decode exactly like the tolerant path
+static size_t cross_check(const Line* lines, size_t count) {
+    size_t bad = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned long long a1 = 0, a2 = 0, d1 = 0, d2 = 0, s1 = 0, s2 = 0;
+        int l1 = 0, l2 = 0, dv1 = 0, dv2 = 0, sv1 = 0, sv2 = 0;
+        const char* p = lines[i].p;
+        size_t n = lines[i].n;
+        if (parse_eip_fast(p, n, &a1, &l1)) {
+            if (!parse_eip_line(p, n, &a2, &l2) || a1 != a2 || l1 != l2) bad++;
+        } else if (parse_dst_src_fast(p, n, &d1, &dv1, &s1, &sv1)) {
+            parse_dst_src_line(p, n, &d2, &dv2, &s2, &sv2);
+            if (d1 != d2 || dv1 != dv2 || s1 != s2 || sv1 != sv2) bad++;
+        }
+    }
+    return bad;
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = (argc > 1) ? argv[1] : "trace_files/Trace1half.trc";
+    int reps = (argc > 2) ? atoi(argv[2]) : 200;
+    if (reps < 1) reps = 1;
+
+    size_t size, count, hits = 0;
+    char* buf = load_file(path, &size);
+    Line* lines = split_lines(buf, size, &count);
+    double records = (double)count / 2.0 * reps;
+
+    unsigned long long sum_slow = 0, sum_fast = 0;
+    clock_t start = clock();
+    for (int r = 0; r < reps; r++)
+        sum_slow += parse_all(lines, count, 0, &hits);
+    double t_slow = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (int r = 0; r < reps; r++)
+        sum_fast += parse_all(lines, count, 1, &hits);
+    double t_fast = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("Trace:\t\t\t%s (%zu lines x %d reps)\n", path, count, reps);
+    printf("Fast path lines:\t%.2f%%\n", count ? 100.0 * hits / count : 0.0);
+    printf("Tolerant parser:\t%.3f s (%.2f M records/s)\n",
+           t_slow, records / (t_slow > 0 ? t_slow : 1e-9) / 1e6);
+    printf("Fixed-offset parser:\t%.3f s (%.2f M records/s)\n",
+           t_fast, records / (t_fast > 0 ? t_fast : 1e-9) / 1e6);
+    printf("Speedup:\t\t%.2fx\n", t_slow / (t_fast > 0 ? t_fast : 1e-9));
+
+    size_t bad = cross_check(lines, count);
+    free(lines);
+    free(buf);
+    if (bad || sum_slow != sum_fast) {
+        printf("Error: %zu lines decode differently.\n", bad);
+        return 1;
+    }
+    return 0;
+}
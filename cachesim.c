@@ -0,0 +1,1008 @@
+#include "cachesim.h"
+#include "prefetch.h"
+#include "shadow.h"
+#include "victim.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64   // host cache line, tag store alignment
+#define LRU_IDENTITY 0xFEDCBA9876543210ULL
+#define NIBBLES_1 0x1111111111111111ULL
+#define NIBBLES_8 0x8888888888888888ULL
+#define LANES2_1 0x5555555555555555ULL   // low bit of every 2-bit RRPV
+
+#define RRPV_MAX 3          // 2-bit RRPV: 0 = near, 3 = distant re-reference
+#define BRRIP_LONG_ODDS 32  // BRRIP inserts at RRPV_MAX - 1 once in 32
+#define PSEL_MAX 1023       // 10-bit DRRIP policy selector
+#define PSEL_MID 512
+#define DUEL_LEADERS 32     // leader sets per DRRIP component
+#define STORE_CYCLES 4      // one 32-bit word written over the bus
+#define PAGE_BYTES 4096     // a PHYS_FLUSH_PAGE record covers one page frame
+
+// Way-compare path, picked at build time: AVX2 with -mavx2, SSE2 on any
+// x86-64, scalar elsewhere or with -DCACHESIM_SCALAR
+#if defined(__AVX2__) && !defined(CACHESIM_SCALAR)
+#include <immintrin.h>
+#define CACHE_SIMD_AVX2
+#define CACHE_SIMD_SSE2
+#define CACHE_SIMD_NAME "AVX2"
+#elif defined(__SSE2__) && !defined(CACHESIM_SCALAR)
+#include <emmintrin.h>
+#define CACHE_SIMD_SSE2
+#define CACHE_SIMD_NAME "SSE2"
+#else
+#define CACHE_SIMD_NAME "scalar"
+#endif
+
+static void cache_select_kernel(CacheSim *cs);
+
+static void *cache_alloc_lines(size_t bytes) {
+    bytes = (bytes + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+#ifdef _WIN32
+    void *p = _aligned_malloc(bytes, CACHE_LINE);
+#else
+    void *p = NULL;
+    if (posix_memalign(&p, CACHE_LINE, bytes) != 0) p = NULL;
+#endif
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+static void cache_free_lines(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void cache_sim_init(CacheSim *cs,
+                    int cache_size_kb,
+                    int block_size,
+                    int associativity,
+                    ReplacementPolicy policy) {
+    if (!cs) return;
+
+    cs->cache_size_kb = cache_size_kb;
+    cs->block_size = block_size;
+    cs->associativity = associativity;
+    cs->policy = policy;
+
+    cs->num_blocks = (cache_size_kb * 1024) / block_size;
+    cs->num_sets = cs->num_blocks / associativity;
+    cs->offset_bits = (int)log2(block_size);
+    cs->index_bits = (int)log2(cs->num_sets);
+    cs->tag_bits = 32 - cs->offset_bits - cs->index_bits; // assume 32-bit PA
+    cs->set_mask = (uint32_t)cs->num_sets - 1U;
+    cs->fill_cycles = 4 * ((block_size + 3) / 4); // 4 cycles per 32-bit word
+    cs->write_policy = WRITE_AS_READ;
+    cs->write_allocate = 1;
+
+    cs->accesses = 0;
+    cs->hits = 0;
+    cs->misses = 0;
+    cs->compulsory_misses = 0;
+    cs->conflict_misses = 0;
+    cs->writebacks = 0;
+    cs->memory_writes = 0;
+    cs->prefetch_fills = 0;
+    cs->prefetch_useful = 0;
+    cs->prefetch_late = 0;
+    cs->prefetch_unused = 0;
+    cs->class_compulsory = 0;
+    cs->class_capacity = 0;
+    cs->class_conflict = 0;
+    cs->instruction_bytes = 0;
+    cs->srcdst_bytes = 0;
+    cs->total_cycles = 0;
+    cs->total_instructions = 0;
+
+    cache_sim_seed(cs, 1);
+
+    // 32-bit tags are enough: tag_bits <= 32 for a 32-bit PA
+    size_t nlines = (size_t)cs->num_sets * (size_t)associativity;
+    cs->tags = (uint32_t *)cache_alloc_lines(nlines * sizeof(uint32_t));
+    cs->sets = (CacheSetMeta *)cache_alloc_lines((size_t)cs->num_sets * sizeof(CacheSetMeta));
+
+    if (!cs->tags || !cs->sets) {
+        fprintf(stderr, "Error: cache_sim_init out of memory.\n");
+        exit(1);
+    }
+    cs->psel = PSEL_MID;
+    cs->duel_stride = (unsigned int)(cs->num_sets / DUEL_LEADERS);
+    if (cs->duel_stride < 2) cs->duel_stride = 2;  // small caches: all leaders
+
+    cs->prefetcher = NULL;
+    cs->pf_ready = NULL;
+    cs->pc = 0;
+    cs->shadow = NULL;
+    cs->victim = NULL;
+
+    if (policy == POLICY_LRU) {
+        // every set starts with the stack 0, 1, .., 15 (way 0 most recent)
+        for (int i = 0; i < cs->num_sets; i++)
+            cs->sets[i].repl = LRU_IDENTITY;
+    }
+    cache_select_kernel(cs);
+}
+
+void cache_sim_free(CacheSim *cs) {
+    if (!cs) return;
+    cache_free_lines(cs->tags);
+    cache_free_lines(cs->sets);
+    free(cs->pf_ready);
+    cs->tags = NULL;
+    cs->sets = NULL;
+    cs->pf_ready = NULL;
+    cs->prefetcher = NULL;
+    cs->shadow = NULL;
+    cs->victim = NULL;
+}
+
+// Seed the RND policy generator. The same seed and configuration always
+// give the same victims, whichever thread runs the cache
+void cache_sim_seed(CacheSim *cs, unsigned long long seed) {
+    // splitmix64 so that small seeds still give a well mixed, non-zero state
+    unsigned long long z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    cs->rng_state = z ? z : 1;
+}
+
+void cache_sim_write_policy(CacheSim *cs, WritePolicy policy, int write_allocate) {
+    cs->write_policy = policy;
+    cs->write_allocate = write_allocate;
+}
+
+// xorshift64* step
+static unsigned int cache_rand(CacheSim *cs) {
+    unsigned long long x = cs->rng_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    cs->rng_state = x;
+    return (unsigned int)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+const char *cache_policy_name(ReplacementPolicy policy) {
+    switch (policy) {
+    case POLICY_RR:   return "Round Robin";
+    case POLICY_RND:  return "Random";
+    case POLICY_LRU:  return "LRU";
+    case POLICY_PLRU: return "Tree PLRU";
+    case POLICY_NRU:  return "NRU";
+    case POLICY_SRRIP: return "SRRIP";
+    case POLICY_BRRIP: return "BRRIP";
+    case POLICY_DRRIP: return "DRRIP";
+    case POLICY_COUNT: break;
+    }
+    return "";
+}
+
+const char *cache_write_policy_name(WritePolicy policy, int write_allocate) {
+    switch (policy) {
+    case WRITE_AS_READ: return "None (stores as reads)";
+    case WRITE_BACK:
+        return write_allocate ? "Write-back, write-allocate"
+                                  : "Write-back, no-write-allocate";
+    case WRITE_THROUGH:
+        return write_allocate ? "Write-through, write-allocate"
+                                  : "Write-through, no-write-allocate";
+    }
+    return "";
+}
+
+// Parse a -w option. Returns 1 if OK, 0 if unknown
+int cache_write_policy_parse(const char *opt, WritePolicy *policy) {
+    if (strcmp(opt, "wb") == 0) {
+        *policy = WRITE_BACK;
+    } else if (strcmp(opt, "wt") == 0) {
+        *policy = WRITE_THROUGH;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Parse a -r option. Returns 1 if OK, 0 if unknown
+int cache_policy_parse(const char *opt, ReplacementPolicy *policy) {
+    if (strcmp(opt, "rr") == 0) {
+        *policy = POLICY_RR;
+    } else if (strcmp(opt, "rnd") == 0 || strcmp(opt, "RND") == 0) {
+        *policy = POLICY_RND;
+    } else if (strcmp(opt, "lru") == 0) {
+        *policy = POLICY_LRU;
+    } else if (strcmp(opt, "plru") == 0) {
+        *policy = POLICY_PLRU;
+    } else if (strcmp(opt, "nru") == 0) {
+        *policy = POLICY_NRU;
+    } else if (strcmp(opt, "srrip") == 0) {
+        *policy = POLICY_SRRIP;
+    } else if (strcmp(opt, "brrip") == 0) {
+        *policy = POLICY_BRRIP;
+    } else if (strcmp(opt, "drrip") == 0) {
+        *policy = POLICY_DRRIP;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+const char *cache_simd_name(void) {
+    return CACHE_SIMD_NAME;
+}
+
+// Bit w set when way w holds tag, valid or not. Sets start 64-byte
+// aligned and hold a power-of-two number of ways, so 4- and 8-way groups
+// are always 16- and 32-byte aligned
+static inline uint32_t cache_match_ways(const uint32_t *ways, int assoc,
+                                        uint32_t tag) {
+    uint32_t match = 0;
+    int way = 0;
+#ifdef CACHE_SIMD_AVX2
+    __m256i key8 = _mm256_set1_epi32((int)tag);
+    for (; way + 8 <= assoc; way += 8) {
+        __m256i v = _mm256_load_si256((const __m256i *)(ways + way));
+        __m256i eq = _mm256_cmpeq_epi32(v, key8);
+        match |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(eq)) << way;
+    }
+#endif
+#ifdef CACHE_SIMD_SSE2
+    __m128i key4 = _mm_set1_epi32((int)tag);
+    for (; way + 4 <= assoc; way += 4) {
+        __m128i v = _mm_load_si128((const __m128i *)(ways + way));
+        __m128i eq = _mm_cmpeq_epi32(v, key4);
+        match |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(eq)) << way;
+    }
+#endif
+    for (; way < assoc; way++)
+        match |= (uint32_t)(ways[way] == tag) << way;
+    return match;
+}
+
+// REPLACEMENT POLICIES
+//
+// CacheSetMeta.repl holds each policy's per-set state:
+//   RR    next victim way
+//   LRU   recency stack, one way number per nibble, MRU in nibble 0 and
+//         LRU in nibble ways-1 (64 bits for 16 ways)
+//   PLRU  tree bits, node n = 1..ways-1 at bit n, 1 = victim on the right
+//         (15 bits for 16 ways)
+//   NRU   referenced bit per way, cleared all at once when every way is set
+//   RRIP  2-bit RRPV per way (32 bits for 16 ways). Hits reset it to 0,
+//         fills insert at 2 (SRRIP) or mostly 3 (BRRIP); the victim is
+//         the first way at 3 after ageing the set until one is.
+// Empty ways are always filled lowest first, before the policy is asked.
+
+// Move way to the top of the LRU stack
+static inline uint64_t lru_touch(uint64_t stack, unsigned int way) {
+    // find the nibble holding way: x has a zero nibble there
+    uint64_t x = stack ^ (NIBBLES_1 * way);
+    uint64_t zero = (x - NIBBLES_1) & ~x & NIBBLES_8;
+    int pos = __builtin_ctzll(zero) >> 2;
+    // shift the more recent nibbles down one place, way goes on top
+    uint64_t above = (1ULL << (4 * pos)) - 1ULL;
+    uint64_t moved = (above << 4) | 0xFULL;
+    return (stack & ~moved) | ((stack & above) << 4) | way;
+}
+
+// Nodes on each way's path (heap numbering, root = bit 1) and the values
+// that point them all away from the way, for 16 ways. A smaller tree of
+// 2^k ways is the top k levels: its leaf w sits below the 16-way leaf
+// w << (4 - k), so the same entry masked to the first ways - 1 nodes works
+static const uint16_t plru_path16[16] = {
+    0x0116, 0x0116, 0x0216, 0x0216, 0x0426, 0x0426, 0x0826, 0x0826,
+    0x104a, 0x104a, 0x204a, 0x204a, 0x408a, 0x408a, 0x808a, 0x808a,
+};
+static const uint16_t plru_away16[16] = {
+    0x0116, 0x0016, 0x0206, 0x0006, 0x0422, 0x0022, 0x0802, 0x0002,
+    0x1048, 0x0048, 0x2008, 0x0008, 0x4080, 0x0080, 0x8000, 0x0000,
+};
+
+// Point every tree node on way's path away from it
+static inline uint64_t plru_touch(uint64_t bits, unsigned int way, const int ways) {
+    unsigned int shift = (unsigned int)__builtin_ctz(16U / (unsigned int)ways);
+    unsigned int leaf16 = way << shift;
+    uint64_t nodes = ((1ULL << ways) - 1ULL) & ~1ULL;     // bits 1..ways-1
+    uint64_t path = plru_path16[leaf16] & nodes;
+    uint64_t away = plru_away16[leaf16] & nodes;
+    return (bits & ~path) | away;
+}
+
+static inline int plru_victim(uint64_t bits, const int ways) {
+    unsigned int node = 1;
+    for (int half = ways >> 1; half > 0; half >>= 1)
+        node = 2U * node + (unsigned int)((bits >> node) & 1ULL);
+    return (int)node - ways;
+}
+
+static inline uint64_t nru_touch(uint64_t ref, unsigned int way, const int ways) {
+    uint64_t all = (1ULL << ways) - 1ULL;
+    ref |= 1ULL << way;
+    return ((ref & all) == all) ? (1ULL << way) : ref;
+}
+
+static inline uint64_t rrpv_set(uint64_t rrpv, int way, unsigned int value) {
+    return (rrpv & ~(3ULL << (2 * way))) | ((uint64_t)value << (2 * way));
+}
+
+// First way at RRPV_MAX, ageing every way of the set just enough for one
+// to get there (same result as incrementing all and rescanning)
+static inline int rrip_victim(CacheSetMeta *set, const int ways) {
+    uint64_t lanes = LANES2_1 & ((1ULL << (2 * ways)) - 1ULL);
+    uint64_t rrpv = set->repl;
+    uint64_t at_max = rrpv & (rrpv >> 1) & lanes;
+    if (!at_max) {
+        unsigned int oldest = 0;
+        for (int w = 0; w < ways; w++) {
+            unsigned int v = (unsigned int)(rrpv >> (2 * w)) & 3U;
+            if (v > oldest) oldest = v;
+        }
+        rrpv += (uint64_t)(RRPV_MAX - oldest) * lanes;
+        set->repl = rrpv;
+        at_max = rrpv & (rrpv >> 1) & lanes;
+    }
+    return __builtin_ctzll(at_max) >> 1;
+}
+
+static inline unsigned int brrip_insert(CacheSim *cs) {
+    return (cache_rand(cs) % BRRIP_LONG_ODDS == 0) ? RRPV_MAX - 1 : RRPV_MAX;
+}
+
+// DRRIP: leader sets train psel on their demand misses, followers obey it
+static inline unsigned int drrip_insert(CacheSim *cs, uint32_t set_index, int demand) {
+    unsigned int slot = set_index % cs->duel_stride;
+    if (slot == 0) {
+        if (demand && cs->psel < PSEL_MAX) cs->psel++;
+        return RRPV_MAX - 1;
+    }
+    if (slot == cs->duel_stride / 2) {
+        if (demand && cs->psel > 0) cs->psel--;
+        return brrip_insert(cs);
+    }
+    return (cs->psel >= PSEL_MID) ? brrip_insert(cs) : RRPV_MAX - 1;
+}
+
+// Update the policy state after a hit on or a fill into way
+static inline __attribute__((always_inline))
+void cache_policy_touch(CacheSetMeta *set, int way, const int ways, const int policy) {
+    switch (policy) {
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+    case POLICY_DRRIP:
+        set->repl = rrpv_set(set->repl, way, 0);
+        break;
+    case POLICY_LRU:
+        set->repl = lru_touch(set->repl, (unsigned int)way);
+        break;
+    case POLICY_PLRU:
+        set->repl = plru_touch(set->repl, (unsigned int)way, ways);
+        break;
+    case POLICY_NRU:
+        set->repl = nru_touch(set->repl, (unsigned int)way, ways);
+        break;
+    default:
+        break;
+    }
+}
+
+// Update the policy state after a miss filled way; a prefetch fill
+// (demand 0) does not train DRRIP's duel
+static inline __attribute__((always_inline))
+void cache_policy_fill(CacheSim *cs, CacheSetMeta *set, uint32_t set_index,
+                       int way, const int ways, const int policy, const int demand) {
+    switch (policy) {
+    case POLICY_SRRIP:
+        set->repl = rrpv_set(set->repl, way, RRPV_MAX - 1);
+        break;
+    case POLICY_BRRIP:
+        set->repl = rrpv_set(set->repl, way, brrip_insert(cs));
+        break;
+    case POLICY_DRRIP:
+        set->repl = rrpv_set(set->repl, way, drrip_insert(cs, set_index, demand));
+        break;
+    default:
+        cache_policy_touch(set, way, ways, policy);
+        break;
+    }
+}
+
+// Victim way of a full set
+static inline __attribute__((always_inline))
+int cache_policy_victim(CacheSim *cs, CacheSetMeta *set, const int ways, const int policy) {
+    switch (policy) {
+    case POLICY_RR: {
+        unsigned int pos = (unsigned int)set->repl % (unsigned int)ways;
+        set->repl = (pos + 1U) % (unsigned int)ways;
+        return (int)pos;
+    }
+    case POLICY_LRU:
+        return (int)((set->repl >> (4 * (ways - 1))) & 0xFULL);
+    case POLICY_PLRU:
+        return plru_victim(set->repl, ways);
+    case POLICY_NRU:
+        return __builtin_ctzll(~set->repl & ((1ULL << ways) - 1ULL));
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+    case POLICY_DRRIP:
+        return rrip_victim(set, ways);
+    default:
+        return (int)(cache_rand(cs) % (unsigned int)ways);
+    }
+}
+
+// A store into a resident block: mark it dirty or write the word through
+static inline __attribute__((always_inline))
+void cache_store(CacheSim *cs, CacheSetMeta *set, int way) {
+    if (cs->write_policy == WRITE_BACK) {
+        set->dirty |= 1U << way;
+    } else {
+        cs->memory_writes++;
+        cs->total_cycles += STORE_CYCLES;
+    }
+}
+
+// A prefetched block leaves line before any demand used it
+static inline void cache_prefetch_unused(CacheSim *cs, size_t line) {
+    if (cs->pf_ready && cs->pf_ready[line]) {
+        cs->prefetch_unused++;
+        cs->pf_ready[line] = 0;
+    }
+}
+
+// Invalidate a way, writing the block back first if it is dirty
+static inline void cache_drop(CacheSim *cs, CacheSetMeta *set, int way) {
+    if (set->dirty & (1U << way)) {
+        cs->writebacks++;
+        cs->total_cycles += (unsigned long long)cs->fill_cycles;
+    }
+    set->valid &= ~(1U << way);
+    set->dirty &= ~(1U << way);
+    cache_prefetch_unused(cs, (size_t)(set - cs->sets) * (size_t)cs->associativity +
+                                  (size_t)way);
+}
+
+// Demand hit with a prefetcher attached. The first demand on a prefetched
+// block waits out whatever is left of its fill. Out of line: the kernels
+// only pay a NULL test without one
+static void cache_prefetch_hit(CacheSim *cs, size_t line, unsigned long long phys_addr,
+                               int fetch) {
+    PrefetchEvent event = PREFETCH_HIT;
+    unsigned long long ready = cs->pf_ready[line];
+    if (ready) {
+        cs->prefetch_useful++;
+        if (ready > cs->total_cycles) {
+            cs->prefetch_late++;
+            cs->total_cycles = ready;
+        }
+        cs->pf_ready[line] = 0;
+        event = PREFETCH_HIT_PREFETCHED;
+    }
+    prefetch_observe(cs->prefetcher, cs, phys_addr, event, fetch);
+}
+
+// Demand miss with a prefetcher attached; line is the filled way, or
+// SIZE_MAX for a store that did not allocate
+static void cache_prefetch_miss(CacheSim *cs, size_t line, unsigned long long phys_addr,
+                                int fetch) {
+    if (line != SIZE_MAX)
+        cache_prefetch_unused(cs, line);
+    prefetch_observe(cs->prefetcher, cs, phys_addr, PREFETCH_MISS, fetch);
+}
+
+// 3C class of a demand access, from the shadow fully associative cache
+static void cache_classify(CacheSim *cs, unsigned long long block_num, int hit) {
+    ShadowResult r = shadow_access(cs->shadow, block_num);
+    if (hit)
+        return;
+    if (r == SHADOW_COLD)
+        cs->class_compulsory++;
+    else if (r == SHADOW_MISS)
+        cs->class_capacity++;
+    else
+        cs->class_conflict++;
+}
+
+// Move the block in way to the victim cache instead of writing it back;
+// a dirty block pushed out of the victim cache is written back instead
+static void cache_victim_evict(CacheSim *cs, CacheSetMeta *set, uint32_t set_index,
+                               int way) {
+    unsigned long long tag = cs->tags[(size_t)set_index * (size_t)cs->associativity +
+                                      (size_t)way];
+    unsigned long long block = tag * (unsigned long long)cs->num_sets + set_index;
+    if (victim_put(cs->victim, block, (set->dirty >> way) & 1U)) {
+        cs->writebacks++;
+        cs->total_cycles += (unsigned long long)cs->fill_cycles;
+    }
+    set->dirty &= ~(1U << way);
+}
+
+// A page flush also drops the block from the victim cache and the shadow
+static void cache_hooks_drop(CacheSim *cs, unsigned long long block_num) {
+    if (cs->victim && victim_drop(cs->victim, block_num)) {
+        cs->writebacks++;
+        cs->total_cycles += (unsigned long long)cs->fill_cycles;
+    }
+    if (cs->shadow)
+        shadow_invalidate(cs->shadow, block_num);
+}
+
+// CACHE KERNELS
+//
+// cache_access_kernel() is instantiated once per policy and associativity
+// with ways, pow2 and policy as constants: the way loops unroll, % and /
+// by the way count become masks, the policy switch folds away, and with
+// power-of-two geometry the address split is shift/mask from
+// offset_bits/index_bits. Direct-mapped ends up as one tag compare. Non
+// power-of-two sizes, and caches with a prefetcher, 3C shadow or victim
+// cache, fall back to the generic kernel, so the specialized ones carry
+// none of those hooks.
+
+static inline __attribute__((always_inline))
+void cache_access_kernel(CacheSim *cs, unsigned long long phys_addr,
+                         const int ways, const int pow2, const int policy,
+                         const int hooks) {
+    int store = (phys_addr & CACHE_WRITE) != 0;
+    int drop = (phys_addr & CACHE_INVALIDATE) != 0;
+    int fetch = (phys_addr & CACHE_FETCH) != 0;
+    phys_addr &= CACHE_ADDR_MASK;
+
+    unsigned long long block_num;
+    uint32_t set_index, tag;
+    if (pow2) {
+        block_num = phys_addr >> cs->offset_bits;
+        set_index = (uint32_t)block_num & cs->set_mask;
+        tag = (uint32_t)(block_num >> cs->index_bits);
+    } else {
+        block_num = phys_addr / (unsigned long long)cs->block_size;
+        set_index = (uint32_t)(block_num % (unsigned long long)cs->num_sets);
+        tag = (uint32_t)(block_num / (unsigned long long)cs->num_sets);
+    }
+
+    CacheSetMeta *set = &cs->sets[set_index];
+    uint32_t *way_tags = &cs->tags[(size_t)set_index * (size_t)ways];
+    uint32_t valid = set->valid;
+
+    // check for hit: all ways at once
+    uint32_t hit = cache_match_ways(way_tags, ways, tag) & valid;
+    if (drop) {
+        if (hit)
+            cache_drop(cs, set, __builtin_ctz(hit));
+        if (hooks)
+            cache_hooks_drop(cs, block_num);
+        return;
+    }
+
+    cs->accesses++;
+    if (hooks && cs->shadow)
+        cache_classify(cs, block_num, hit != 0);
+    if (hit) {
+        cs->hits++;
+        cs->total_cycles += 1; // 1 cycle for cache hit
+        int way = __builtin_ctz(hit);
+        cache_policy_touch(set, way, ways, policy);
+        if (store)
+            cache_store(cs, set, way);
+        if (hooks && cs->prefetcher)
+            cache_prefetch_hit(cs, (size_t)set_index * (size_t)ways + (size_t)way,
+                               phys_addr, fetch);
+        return;
+    }
+
+    // miss, cost to fill this cache block from memory (bus 32-bit) 
+    cs->misses++;
+    if (store && !cs->write_allocate) {
+        // the word goes straight to memory, the cache is left alone
+        cs->memory_writes++;
+        cs->total_cycles += STORE_CYCLES;
+        if (hooks && cs->prefetcher)
+            cache_prefetch_miss(cs, SIZE_MAX, phys_addr, fetch);
+        return;
+    }
+    int refill_dirty = 0;
+    if (hooks && cs->victim && victim_take(cs->victim, block_num, &refill_dirty))
+        cs->total_cycles += VICTIM_HIT_CYCLES;   // swapped back, no memory fill
+    else
+        cs->total_cycles += (unsigned long long)cs->fill_cycles;
+
+    // find victim: lowest empty way first, from the same way bitmask
+    int victim;
+    uint32_t all_ways = (uint32_t)((1ULL << ways) - 1ULL);
+    uint32_t empty = ~valid & all_ways;
+    if (empty) {
+        victim = __builtin_ctz(empty);
+        cs->compulsory_misses++;
+    } else {
+        cs->conflict_misses++;
+        victim = cache_policy_victim(cs, set, ways, policy);
+        if (hooks && cs->victim) {
+            cache_victim_evict(cs, set, set_index, victim);
+        } else if (set->dirty & (1U << victim)) {
+            // write the old block back before the fill
+            cs->writebacks++;
+            cs->total_cycles += (unsigned long long)cs->fill_cycles;
+            set->dirty &= ~(1U << victim);
+        }
+    }
+
+    set->valid = valid | (1U << victim);
+    way_tags[victim] = tag;
+    if (refill_dirty)
+        set->dirty |= 1U << victim;
+    cache_policy_fill(cs, set, set_index, victim, ways, policy, 1);
+    if (store)
+        cache_store(cs, set, victim);
+    if (hooks && cs->prefetcher)
+        cache_prefetch_miss(cs, (size_t)set_index * (size_t)ways + (size_t)victim,
+                            phys_addr, fetch);
+}
+
+// Split [phys_addr, phys_addr + len - 1] into blocks for sink
+static inline __attribute__((always_inline))
+void replay_range(const CacheSim *cs, unsigned long long phys_addr, int len,
+                  unsigned long long store, CacheBlockSink sink, void *ctx,
+                  const int pow2) {
+    unsigned long long last = phys_addr + (unsigned long long)len - 1ULL;
+    if (pow2) {
+        int shift = cs->offset_bits;
+        for (unsigned long long b = phys_addr >> shift; b <= last >> shift; b++)
+            sink(ctx, (b << shift) | store);
+    } else {
+        unsigned long long bs = (unsigned long long)cs->block_size;
+        for (unsigned long long b = phys_addr / bs; b <= last / bs; b++)
+            sink(ctx, (b * bs) | store);
+    }
+}
+
+// Instruction bookkeeping on cs, block accesses go to sink. Inlined with a
+// constant sink so each kernel's replay calls it directly
+static inline __attribute__((always_inline))
+void replay_records(CacheSim *cs, const PhysRecord *recs, size_t n,
+                    CacheBlockSink sink, void *ctx, const int pow2) {
+    // dstM blocks carry CACHE_WRITE unless stores are simulated as reads
+    unsigned long long store = (cs->write_policy != WRITE_AS_READ) ? CACHE_WRITE : 0ULL;
+    for (size_t i = 0; i < n; i++) {
+        const PhysRecord *r = &recs[i];
+
+        if (r->flags & PHYS_FLUSH_PAGE) {
+            replay_range(cs, r->eip_pa, PAGE_BYTES, CACHE_INVALIDATE, sink, ctx, pow2);
+            continue;
+        }
+        cs->total_instructions++;
+        cs->instruction_bytes += r->len;
+        if (r->flags & PHYS_COUNT_ONLY)
+            continue;
+        cs->pc = r->eip;
+
+        // EIP fetch 
+        if (r->flags & PHYS_EIP_MAPPED)
+            replay_range(cs, r->eip_pa, r->len, CACHE_FETCH, sink, ctx, pow2);
+        cs->total_cycles += 2; // execute instruction 
+
+        // dstM: write 4 bytes 
+        if (r->flags & PHYS_DST_USED) {
+            if (r->flags & PHYS_DST_MAPPED)
+                replay_range(cs, r->dst_pa, 4, store, sink, ctx, pow2);
+            cs->total_cycles += 1; // effective address 
+            cs->srcdst_bytes += 4;
+        }
+
+        // srcM: read 4 bytes 
+        if (r->flags & PHYS_SRC_USED) {
+            if (r->flags & PHYS_SRC_MAPPED)
+                replay_range(cs, r->src_pa, 4, 0ULL, sink, ctx, pow2);
+            cs->total_cycles += 1; // effective address 
+            cs->srcdst_bytes += 4;
+        }
+    }
+}
+
+// access, sink and replay entry points of one kernel
+#define CACHE_KERNEL(name, ways, pow2, policy)                                \
+    static void cache_access_##name(CacheSim *cs, unsigned long long addr) {  \
+        cache_access_kernel(cs, addr, ways, pow2, policy, 0);                 \
+    }                                                                         \
+    static void cache_sink_##name(void *ctx, unsigned long long addr) {       \
+        cache_access_kernel((CacheSim *)ctx, addr, ways, pow2, policy, 0);    \
+    }                                                                         \
+    static void cache_replay_##name(CacheSim *cs, const PhysRecord *recs,     \
+                                    size_t n) {                               \
+        replay_records(cs, recs, n, cache_sink_##name, cs, pow2);             \
+    }
+
+// one kernel per associativity for a policy, and its dispatch table row
+#define CACHE_POLICY_KERNELS(p, policy)                                       \
+    CACHE_KERNEL(p##_w1, 1, 1, policy)                                        \
+    CACHE_KERNEL(p##_w2, 2, 1, policy)                                        \
+    CACHE_KERNEL(p##_w4, 4, 1, policy)                                        \
+    CACHE_KERNEL(p##_w8, 8, 1, policy)                                        \
+    CACHE_KERNEL(p##_w16, 16, 1, policy)
+#define CACHE_POLICY_ROW(p)                                                   \
+    {{cache_access_##p##_w1, cache_replay_##p##_w1},                          \
+     {cache_access_##p##_w2, cache_replay_##p##_w2},                          \
+     {cache_access_##p##_w4, cache_replay_##p##_w4},                          \
+     {cache_access_##p##_w8, cache_replay_##p##_w8},                          \
+     {cache_access_##p##_w16, cache_replay_##p##_w16}}
+
+CACHE_POLICY_KERNELS(rr, POLICY_RR)
+CACHE_POLICY_KERNELS(rnd, POLICY_RND)
+CACHE_POLICY_KERNELS(lru, POLICY_LRU)
+CACHE_POLICY_KERNELS(plru, POLICY_PLRU)
+CACHE_POLICY_KERNELS(nru, POLICY_NRU)
+CACHE_POLICY_KERNELS(srrip, POLICY_SRRIP)
+CACHE_POLICY_KERNELS(brrip, POLICY_BRRIP)
+CACHE_POLICY_KERNELS(drrip, POLICY_DRRIP)
+
+// generic kernel: runtime associativity, policy and div/mod geometry
+static void cache_access_generic(CacheSim *cs, unsigned long long addr) {
+    cache_access_kernel(cs, addr, cs->associativity, 0, cs->policy, 1);
+}
+static void cache_sink_generic(void *ctx, unsigned long long addr) {
+    cache_access_generic((CacheSim *)ctx, addr);
+}
+static void cache_replay_generic(CacheSim *cs, const PhysRecord *recs, size_t n) {
+    replay_records(cs, recs, n, cache_sink_generic, cs, 0);
+}
+
+typedef struct {
+    CacheAccessFn access;
+    CacheReplayFn replay;
+} CacheKernel;
+
+#define KERNEL_WAYS 5   // 1, 2, 4, 8, 16
+
+// [policy][log2(ways)], rows in ReplacementPolicy order
+static const CacheKernel cache_kernels[POLICY_COUNT][KERNEL_WAYS] = {
+    CACHE_POLICY_ROW(rr),
+    CACHE_POLICY_ROW(rnd),
+    CACHE_POLICY_ROW(lru),
+    CACHE_POLICY_ROW(plru),
+    CACHE_POLICY_ROW(nru),
+    CACHE_POLICY_ROW(srrip),
+    CACHE_POLICY_ROW(brrip),
+    CACHE_POLICY_ROW(drrip),
+};
+
+static int is_pow2(int x) {
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+// Pick the kernel for cs's geometry, once at init
+static void cache_select_kernel(CacheSim *cs) {
+    cs->access = cache_access_generic;
+    cs->replay = cache_replay_generic;
+    if (!is_pow2(cs->block_size) || !is_pow2(cs->num_sets) ||
+        !is_pow2(cs->associativity) || cs->associativity > 16)
+        return;
+    int w = __builtin_ctz((unsigned int)cs->associativity);
+    cs->access = cache_kernels[cs->policy][w].access;
+    cs->replay = cache_kernels[cs->policy][w].replay;
+}
+
+// One cache access for ONE block 
+void cache_access_block(CacheSim *cs, unsigned long long phys_addr) {
+    cs->access(cs, phys_addr);
+}
+
+// Access a range [phys_addr, phys_addr + len - 1], may touch multiple blocks 
+void cache_access_range(CacheSim *cs,
+                        unsigned long long phys_addr,
+                        int len) {
+    unsigned long long first_block =
+        phys_addr / (unsigned long long)cs->block_size;
+    unsigned long long last_block =
+        (phys_addr + (unsigned long long)len - 1ULL) /
+        (unsigned long long)cs->block_size;
+
+    for (unsigned long long b = first_block; b <= last_block; b++) {
+        unsigned long long block_addr =
+            b * (unsigned long long)cs->block_size;
+        cache_access_block(cs, block_addr);
+    }
+}
+
+void cache_sim_replay(CacheSim *cs, const PhysRecord *recs, size_t n) {
+    cs->replay(cs, recs, n);
+}
+
+void cache_sim_replay_to(CacheSim *cs, const PhysRecord *recs, size_t n,
+                         CacheBlockSink sink, void *ctx) {
+    replay_records(cs, recs, n, sink, ctx, 0);
+}
+
+// SINGLE-LEVEL OPERATIONS for a cache hierarchy
+//
+// A hierarchy needs lookups that do not fill and fills that report the
+// victim, so these split cache_access_block() in two. They run the same
+// policy code with runtime geometry.
+
+static inline void cache_split(const CacheSim *cs, unsigned long long phys_addr,
+                               uint32_t *set_index, uint32_t *tag) {
+    unsigned long long block_num = phys_addr / (unsigned long long)cs->block_size;
+    *set_index = (uint32_t)(block_num % (unsigned long long)cs->num_sets);
+    *tag = (uint32_t)(block_num / (unsigned long long)cs->num_sets);
+}
+
+// Way holding phys_addr's block, -1 if not present
+static int cache_find(const CacheSim *cs, uint32_t set_index, uint32_t tag) {
+    const uint32_t *way_tags = &cs->tags[(size_t)set_index * (size_t)cs->associativity];
+    uint32_t hit = cache_match_ways(way_tags, cs->associativity, tag) &
+                   cs->sets[set_index].valid;
+    return hit ? __builtin_ctz(hit) : -1;
+}
+
+int cache_probe(CacheSim *cs, unsigned long long phys_addr) {
+    uint32_t set_index, tag;
+    cache_split(cs, phys_addr, &set_index, &tag);
+    cs->accesses++;
+    int way = cache_find(cs, set_index, tag);
+    if (way < 0) {
+        cs->misses++;
+        return 0;
+    }
+    cs->hits++;
+    cache_policy_touch(&cs->sets[set_index], way, cs->associativity, cs->policy);
+    return 1;
+}
+
+int cache_holds(const CacheSim *cs, unsigned long long phys_addr) {
+    uint32_t set_index, tag;
+    cache_split(cs, phys_addr, &set_index, &tag);
+    return cache_find(cs, set_index, tag) >= 0;
+}
+
+int cache_fill(CacheSim *cs, unsigned long long phys_addr,
+               unsigned long long *evicted_addr) {
+    uint32_t set_index, tag;
+    cache_split(cs, phys_addr, &set_index, &tag);
+    CacheSetMeta *set = &cs->sets[set_index];
+    int ways = cs->associativity;
+    int evicted = 0;
+
+    int victim = cache_find(cs, set_index, tag);
+    if (victim < 0) {
+        uint32_t empty = ~set->valid & (uint32_t)((1ULL << ways) - 1ULL);
+        if (empty) {
+            victim = __builtin_ctz(empty);
+        } else {
+            victim = cache_policy_victim(cs, set, ways, cs->policy);
+            unsigned long long old = cs->tags[(size_t)set_index * (size_t)ways + (size_t)victim];
+            *evicted_addr = (old * (unsigned long long)cs->num_sets + set_index) *
+                            (unsigned long long)cs->block_size;
+            evicted = 1;
+            if (set->dirty & (1U << victim)) {
+                // write the old block back before the fill, as the kernels do
+                cs->writebacks++;
+                cs->total_cycles += (unsigned long long)cs->fill_cycles;
+            }
+        }
+        set->dirty &= ~(1U << victim);
+    }
+
+    set->valid |= 1U << victim;
+    cs->tags[(size_t)set_index * (size_t)ways + (size_t)victim] = tag;
+    cache_policy_fill(cs, set, set_index, victim, ways, cs->policy, 1);
+    return evicted;
+}
+
+int cache_invalidate(CacheSim *cs, unsigned long long phys_addr) {
+    uint32_t set_index, tag;
+    cache_split(cs, phys_addr, &set_index, &tag);
+    int way = cache_find(cs, set_index, tag);
+    if (way < 0)
+        return 0;
+    cache_drop(cs, &cs->sets[set_index], way);
+    return 1;
+}
+
+// Invalidate every block (context switch), writing back dirty ones
+void cache_sim_flush(CacheSim *cs) {
+    for (int s = 0; s < cs->num_sets; s++) {
+        CacheSetMeta *set = &cs->sets[s];
+        while (set->valid)
+            cache_drop(cs, set, __builtin_ctz(set->valid));
+    }
+    if (cs->victim) {
+        int dirty = victim_flush(cs->victim);
+        cs->writebacks += (unsigned long long)dirty;
+        cs->total_cycles += (unsigned long long)dirty * (unsigned long long)cs->fill_cycles;
+    }
+    if (cs->shadow)
+        shadow_flush(cs->shadow);
+}
+
+// Add the access counters of part (a shard of cs) into cs
+void cache_sim_merge(CacheSim *cs, const CacheSim *part) {
+    cs->accesses += part->accesses;
+    cs->hits += part->hits;
+    cs->misses += part->misses;
+    cs->compulsory_misses += part->compulsory_misses;
+    cs->conflict_misses += part->conflict_misses;
+    cs->writebacks += part->writebacks;
+    cs->memory_writes += part->memory_writes;
+    cs->prefetch_fills += part->prefetch_fills;
+    cs->prefetch_useful += part->prefetch_useful;
+    cs->prefetch_late += part->prefetch_late;
+    cs->prefetch_unused += part->prefetch_unused;
+    cs->class_compulsory += part->class_compulsory;
+    cs->class_capacity += part->class_capacity;
+    cs->class_conflict += part->class_conflict;
+    cs->total_cycles += part->total_cycles;
+}
+
+// PREFETCH FILLS
+
+void cache_sim_prefetcher(CacheSim *cs, Prefetcher *pf) {
+    size_t nlines = (size_t)cs->num_sets * (size_t)cs->associativity;
+    cs->pf_ready = (unsigned long long *)calloc(nlines, sizeof(unsigned long long));
+    if (!cs->pf_ready) {
+        fprintf(stderr, "Error: cache_sim_prefetcher out of memory.\n");
+        exit(1);
+    }
+    cs->prefetcher = pf;
+    cs->access = cache_access_generic;
+    cs->replay = cache_replay_generic;
+}
+
+// 3C CLASSIFICATION AND VICTIM CACHE, also on the generic kernel
+
+void cache_sim_classify(CacheSim *cs, ShadowCache *shadow) {
+    cs->shadow = shadow;
+    cs->access = cache_access_generic;
+    cs->replay = cache_replay_generic;
+}
+
+void cache_sim_victim(CacheSim *cs, VictimCache *victim) {
+    cs->victim = victim;
+    cs->access = cache_access_generic;
+    cs->replay = cache_replay_generic;
+}
+
+// The block arrives fill_cycles from now, off the core's critical path,
+// or swapped back from the victim cache. The block it replaces leaves the
+// way a demand miss's would: into the victim cache if there is one,
+// written back if dirty otherwise. The shadow sees the fill too, so it
+// holds the same stream as the real cache
+int cache_prefetch(CacheSim *cs, unsigned long long phys_addr) {
+    uint32_t set_index, tag;
+    cache_split(cs, phys_addr, &set_index, &tag);
+    if (cache_find(cs, set_index, tag) >= 0)
+        return 0;
+
+    unsigned long long block_num = (unsigned long long)tag *
+                                   (unsigned long long)cs->num_sets + set_index;
+    unsigned long long fill = (unsigned long long)cs->fill_cycles;
+    int refill_dirty = 0;
+    if (cs->victim && victim_take(cs->victim, block_num, &refill_dirty))
+        fill = VICTIM_HIT_CYCLES;
+    if (cs->shadow)
+        shadow_access(cs->shadow, block_num);
+
+    CacheSetMeta *set = &cs->sets[set_index];
+    int ways = cs->associativity;
+    int victim;
+    uint32_t empty = ~set->valid & (uint32_t)((1ULL << ways) - 1ULL);
+    if (empty) {
+        victim = __builtin_ctz(empty);
+    } else {
+        victim = cache_policy_victim(cs, set, ways, cs->policy);
+        if (cs->victim)
+            cache_victim_evict(cs, set, set_index, victim);
+        cache_drop(cs, set, victim);
+    }
+
+    size_t line = (size_t)set_index * (size_t)ways + (size_t)victim;
+    set->valid |= 1U << victim;
+    if (refill_dirty)
+        set->dirty |= 1U << victim;
+    cs->tags[line] = tag;
+    cache_policy_fill(cs, set, set_index, victim, ways, cs->policy, 0);
+    cs->pf_ready[line] = cs->total_cycles + fill;
+    cs->prefetch_fills++;
+    return 1;
+}
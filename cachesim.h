@@ -0,0 +1,192 @@
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CACHE SIM STRUCTS (Milestone 3)
+
+typedef enum {
+    POLICY_RR = 0,
+    POLICY_RND = 1,
+    POLICY_LRU = 2,
+    POLICY_PLRU = 3,                // tree pseudo-LRU
+    POLICY_NRU = 4,                 // not recently used (one bit per way)
+    POLICY_SRRIP = 5,               // static re-reference interval prediction
+    POLICY_BRRIP = 6,               // bimodal RRIP, scan resistant
+    POLICY_DRRIP = 7,               // SRRIP/BRRIP chosen by set dueling
+    POLICY_COUNT
+} ReplacementPolicy;
+
+// How stores (dstM) are simulated. WRITE_AS_READ is the original model:
+// a store is an ordinary access and nothing is ever written back
+typedef enum {
+    WRITE_AS_READ = 0,
+    WRITE_BACK = 1,                 // dirty lines cost a block write on eviction
+    WRITE_THROUGH = 2               // every store also writes its word to memory
+} WritePolicy;
+
+// Per-set bookkeeping, kept apart from the tags so a lookup reads one
+// small word here plus the set's tag line
+typedef struct {
+    uint64_t repl;                  // replacement state, layout per policy
+    uint32_t valid;                 // bit w set = way w holds a block
+    uint32_t dirty;                 // bit w set = way w differs from memory
+} CacheSetMeta;
+
+typedef struct CacheSim CacheSim;
+typedef struct PhysRecord PhysRecord;
+typedef struct Prefetcher Prefetcher;
+typedef struct ShadowCache ShadowCache;
+typedef struct VictimCache VictimCache;
+
+// kernel entry points, specialized per associativity (see cachesim.c)
+typedef void (*CacheAccessFn)(CacheSim *cs, unsigned long long phys_addr);
+typedef void (*CacheReplayFn)(CacheSim *cs, const PhysRecord *recs, size_t n);
+
+struct CacheSim {
+    int cache_size_kb;
+    int block_size;
+    int associativity;
+    ReplacementPolicy policy;
+
+    int num_blocks;
+    int num_sets;
+    int offset_bits;
+    int index_bits;
+    int tag_bits;
+    uint32_t set_mask;              // num_sets - 1
+    int fill_cycles;                // cycles to fill a block from memory
+    WritePolicy write_policy;
+    int write_allocate;             // a store miss fills the block
+
+    // stats
+    unsigned long long accesses;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long compulsory_misses;
+    unsigned long long conflict_misses;
+    unsigned long long writebacks;      // dirty blocks written on eviction
+    unsigned long long memory_writes;   // write-through and no-allocate stores
+
+    // prefetching: the counters above stay demand-only
+    unsigned long long prefetch_fills;   // blocks brought in by the prefetcher
+    unsigned long long prefetch_useful;  // prefetched blocks later demanded
+    unsigned long long prefetch_late;    // ... while their fill was in flight
+    unsigned long long prefetch_unused;  // evicted or dropped before any demand
+
+    // 3C classes of the misses (shadow.h); compulsory/conflict_misses above
+    // only tell whether the set still had an empty way
+    unsigned long long class_compulsory;
+    unsigned long long class_capacity;
+    unsigned long long class_conflict;
+
+    unsigned long long instruction_bytes;
+    unsigned long long srcdst_bytes;
+    unsigned long long total_cycles;
+    unsigned long long total_instructions;
+
+    unsigned long long rng_state;   // per-instance PRNG for POLICY_RND/BRRIP
+
+    // DRRIP set dueling: sets with set % duel_stride == 0 always use
+    // SRRIP, == duel_stride / 2 always BRRIP, the rest follow psel
+    unsigned int psel;              // 10-bit saturating, >= 512 = BRRIP
+    unsigned int duel_stride;
+
+    // arrays 
+    CacheSetMeta *sets;             // one per set
+    uint32_t *tags;                 // [num_sets * ways], 64-byte aligned so
+                                    // a set of up to 16 ways is one host line
+
+    CacheAccessFn access;           // chosen by cache_sim_init()
+    CacheReplayFn replay;
+
+    Prefetcher *prefetcher;         // NULL: demand fetch only (prefetch.h)
+    unsigned long long *pf_ready;   // [num_sets * ways] cycle a prefetched block
+                                    // arrives, 0 once demanded or demand filled
+    uint32_t pc;                    // virtual EIP of the instruction being replayed
+    ShadowCache *shadow;            // NULL: misses are not classified
+    VictimCache *victim;            // NULL: no victim cache (victim.h)
+};
+
+// One trace instruction after address translation, the unit the cache
+// stage consumes. Translating once lets any number of caches replay it.
+struct PhysRecord {
+    uint32_t eip_pa;           // physical addresses, valid per flags
+    uint32_t dst_pa;
+    uint32_t src_pa;
+    uint8_t len;               // instruction length in bytes
+    uint8_t flags;             // PHYS_* bits
+    uint16_t reserved;
+    uint32_t eip;              // virtual EIP, the PC the stride prefetcher keys on
+};
+
+#define PHYS_EIP_MAPPED 0x01   // eip_pa holds a translation
+#define PHYS_DST_USED   0x02   // instruction writes dstM
+#define PHYS_DST_MAPPED 0x04
+#define PHYS_SRC_USED   0x08   // instruction reads srcM
+#define PHYS_SRC_MAPPED 0x10
+#define PHYS_COUNT_ONLY 0x20   // over the -n limit: counted, not simulated
+#define PHYS_FLUSH_PAGE 0x40   // not an instruction: drop the evicted page
+                               // frame at eip_pa from the caches
+
+// Physical addresses are 32-bit, so the bits above them in an address
+// handed to cache_access_block() or a CacheBlockSink carry the access kind
+#define CACHE_ADDR_MASK 0xFFFFFFFFULL
+#define CACHE_WRITE (1ULL << 32)        // a store
+#define CACHE_INVALIDATE (1ULL << 33)   // drop the block (page flush), not an access
+#define CACHE_FETCH (1ULL << 34)        // an instruction fetch (for the prefetcher)
+
+void cache_sim_init(CacheSim *cs,
+                    int cache_size_kb,
+                    int block_size,
+                    int associativity,
+                    ReplacementPolicy policy);
+void cache_sim_free(CacheSim *cs);
+void cache_sim_seed(CacheSim *cs, unsigned long long seed);
+void cache_sim_write_policy(CacheSim *cs, WritePolicy policy, int write_allocate);
+const char *cache_policy_name(ReplacementPolicy policy);
+const char *cache_simd_name(void);     // way-compare path built in
+int cache_policy_parse(const char *opt, ReplacementPolicy *policy);
+const char *cache_write_policy_name(WritePolicy policy, int write_allocate);
+int cache_write_policy_parse(const char *opt, WritePolicy *policy);
+void cache_access_block(CacheSim *cs, unsigned long long phys_addr);
+void cache_access_range(CacheSim *cs,
+                        unsigned long long phys_addr,
+                        int len);
+
+// Run a batch of translated instructions through the cache
+void cache_sim_replay(CacheSim *cs, const PhysRecord *recs, size_t n);
+
+// Same instruction bookkeeping on cs, but every block access is handed to
+// sink instead of the cache (used to route blocks to set shards)
+typedef void (*CacheBlockSink)(void *ctx, unsigned long long block_addr);
+void cache_sim_replay_to(CacheSim *cs, const PhysRecord *recs, size_t n,
+                         CacheBlockSink sink, void *ctx);
+void cache_sim_merge(CacheSim *cs, const CacheSim *part);
+
+// One level of a hierarchy. cache_probe() counts an access and returns 1
+// on a hit (updating the policy), 0 on a miss without filling.
+// cache_fill() installs the block (no access counters; a dirty victim is
+// written back) and returns 1 with the victim's address if a valid block
+// was evicted. A block already present keeps its dirty bit. cache_invalidate()
+// returns 1 if the block was present. cache_holds() only looks: no
+// counters, no policy update.
+int cache_probe(CacheSim *cs, unsigned long long phys_addr);
+int cache_holds(const CacheSim *cs, unsigned long long phys_addr);
+int cache_fill(CacheSim *cs, unsigned long long phys_addr,
+               unsigned long long *evicted_addr);
+int cache_invalidate(CacheSim *cs, unsigned long long phys_addr);
+void cache_sim_flush(CacheSim *cs);
+
+// Prefetch support, see prefetch.h. cache_prefetch() fills the block
+// without touching the demand counters and returns 0 if it was present
+void cache_sim_prefetcher(CacheSim *cs, Prefetcher *pf);
+int cache_prefetch(CacheSim *cs, unsigned long long phys_addr);
+
+// Attach a 3C shadow cache (capacity num_blocks) or a victim cache. The
+// caller owns both and frees them after cache_sim_free()
+void cache_sim_classify(CacheSim *cs, ShadowCache *shadow);
+void cache_sim_victim(CacheSim *cs, VictimCache *victim);
+
+#endif
@@ -1,6 +1,5 @@
 #include "config.h"
 
-#include "cache.h"
 #include "vmemory.h"
 
 void config_init(Config* config) {
@@ -9,6 +8,9 @@ void config_init(Config* config) {
     return;
   }
 
-  cache_init(&config->cache);
+  config->cache.cache_size = 0;
+  config->cache.block_size = 0;
+  config->cache.associativity = 0;
+  config->cache.policy = POLICY_RR;
   vmemory_init(&config->vmemory);
 }
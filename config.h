@@ -1,15 +1,26 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#include "cache.h"
+#include "cachesim.h"
 #include "vmemory.h"
 
+typedef struct Cache {
+  // given values
+  int cache_size;
+  int block_size;
+  int associativity;
+  ReplacementPolicy policy;
+
+  // calculated values
+
+} Cache;
+
 typedef struct Config {
   Cache cache;
   VMemory vmemory;
   int instruction;
   int fileCount;
-  char* filenames[3];
+  char** filenames;  // fileCount entries, any number of -f
 
 } Config;
 
@@ -0,0 +1,220 @@
+#include "hierarchy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int level_config_parse(const char *spec, LevelConfig *cfg) {
+    char buf[64];
+    if (strlen(spec) >= sizeof(buf)) return 0;
+    strcpy(buf, spec);
+
+    LevelConfig out = *cfg;
+    int field = 0;
+    for (char *tok = strtok(buf, ":"); tok; tok = strtok(NULL, ":"), field++) {
+        char *end;
+        if (field == 3) {
+            if (!cache_policy_parse(tok, &out.policy)) return 0;
+            continue;
+        }
+        long v = strtol(tok, &end, 10);
+        if (*end != '\0' || v < 0) return 0;
+        switch (field) {
+        case 0: out.size_kb = (int)v; break;
+        case 1: out.block_size = (int)v; break;
+        case 2: out.associativity = (int)v; break;
+        case 4: out.latency = (int)v; break;
+        default: return 0;
+        }
+    }
+    if (field < 3) return 0;
+
+    // same limits as the single cache: power-of-two blocks and up to 16 ways
+    int a = out.associativity;
+    int b = out.block_size;
+    if (out.size_kb < 1 || out.size_kb > 65536) return 0;
+    if (b < 8 || b > 256 || (b & (b - 1))) return 0;
+    if (a < 1 || a > 16 || (a & (a - 1))) return 0;
+    if ((long)out.size_kb * 1024L < (long)b * a) return 0;
+    *cfg = out;
+    return 1;
+}
+
+int inclusion_mode_parse(const char *opt, InclusionMode *mode) {
+    if (strcmp(opt, "inclusive") == 0) {
+        *mode = INCLUSION_INCLUSIVE;
+    } else if (strcmp(opt, "exclusive") == 0) {
+        *mode = INCLUSION_EXCLUSIVE;
+    } else if (strcmp(opt, "nine") == 0 || strcmp(opt, "non-inclusive") == 0) {
+        *mode = INCLUSION_NINE;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+const char *inclusion_mode_name(InclusionMode mode) {
+    switch (mode) {
+    case INCLUSION_NINE:      return "Non-inclusive";
+    case INCLUSION_INCLUSIVE: return "Inclusive";
+    case INCLUSION_EXCLUSIVE: return "Exclusive";
+    }
+    return "";
+}
+
+const char *level_name(int level) {
+    static const char *names[LEVEL_COUNT] = {"L1I", "L1D", "L2", "L3"};
+    return names[level];
+}
+
+int hier_init(Hierarchy *h, const LevelConfig cfg[LEVEL_COUNT], int has_l3,
+              InclusionMode mode, int mem_latency) {
+    memset(h, 0, sizeof(*h));
+    h->num_levels = has_l3 ? 4 : 3;
+    h->mode = mode;
+    h->mem_latency = mem_latency;
+
+    if (mode == INCLUSION_EXCLUSIVE) {
+        for (int l = 1; l < h->num_levels; l++) {
+            if (cfg[l].block_size != cfg[0].block_size)
+                return 0;
+        }
+    }
+    for (int l = 0; l < h->num_levels; l++) {
+        cache_sim_init(&h->cache[l], cfg[l].size_kb, cfg[l].block_size,
+                       cfg[l].associativity, cfg[l].policy);
+        h->latency[l] = cfg[l].latency;
+    }
+    return 1;
+}
+
+void hier_free(Hierarchy *h) {
+    for (int l = 0; l < h->num_levels; l++)
+        cache_sim_free(&h->cache[l]);
+}
+
+void hier_seed(Hierarchy *h, unsigned long long seed) {
+    for (int l = 0; l < h->num_levels; l++)
+        cache_sim_seed(&h->cache[l], seed + (unsigned long long)l);
+}
+
+void hier_flush(Hierarchy *h) {
+    for (int l = 0; l < h->num_levels; l++)
+        cache_sim_flush(&h->cache[l]);
+}
+
+// Drop every block of the levels above `level` that overlaps the block
+// evicted from `level`
+static void hier_back_invalidate(Hierarchy *h, int level, unsigned long long addr) {
+    unsigned long long len = (unsigned long long)h->cache[level].block_size;
+    for (int u = 0; u < level; u++) {
+        unsigned long long bs = (unsigned long long)h->cache[u].block_size;
+        for (unsigned long long a = addr / bs * bs; a < addr + len; a += bs)
+            h->back_invalidations += (unsigned long long)cache_invalidate(&h->cache[u], a);
+    }
+}
+
+// Exclusive: an L1 victim drops into L2, an L2 victim into L3
+static void hier_drop_victim(Hierarchy *h, unsigned long long victim) {
+    for (int l = LEVEL_L2; l < h->num_levels; l++) {
+        if (!cache_fill(&h->cache[l], victim, &victim))
+            return;
+    }
+}
+
+// One block access entering at l1 (LEVEL_L1I or LEVEL_L1D)
+static void hier_access(Hierarchy *h, int l1, unsigned long long addr) {
+    h->total_cycles += (unsigned long long)h->latency[l1];
+    if (cache_probe(&h->cache[l1], addr))
+        return;
+
+    unsigned long long victim;
+    int sibling = (l1 == LEVEL_L1I) ? LEVEL_L1D : LEVEL_L1I;
+    if (h->mode == INCLUSION_EXCLUSIVE && cache_holds(&h->cache[sibling], addr)) {
+        // the block is on chip in the other L1 (and so in no lower level):
+        // copy it across at the cost of an L2 lookup
+        h->total_cycles += (unsigned long long)h->latency[LEVEL_L2];
+        h->sibling_transfers++;
+        if (cache_fill(&h->cache[l1], addr, &victim) &&
+            !cache_holds(&h->cache[sibling], victim))
+            hier_drop_victim(h, victim);
+        return;
+    }
+
+    int found = -1;
+    for (int l = LEVEL_L2; l < h->num_levels; l++) {
+        h->total_cycles += (unsigned long long)h->latency[l];
+        if (cache_probe(&h->cache[l], addr)) {
+            found = l;
+            break;
+        }
+    }
+    if (found < 0) {
+        h->total_cycles += (unsigned long long)h->mem_latency;
+        h->mem_accesses++;
+    }
+
+    if (h->mode == INCLUSION_EXCLUSIVE) {
+        // move the block up; the other L1 may hold the victim too (code
+        // and data in one block): it stays on chip there and drops down
+        // when that copy goes
+        if (found >= 0)
+            cache_invalidate(&h->cache[found], addr);
+        if (cache_fill(&h->cache[l1], addr, &victim) &&
+            !cache_holds(&h->cache[sibling], victim))
+            hier_drop_victim(h, victim);
+        return;
+    }
+
+    // fill every level that missed, lowest first
+    int lowest_miss = (found < 0) ? h->num_levels - 1 : found - 1;
+    for (int l = lowest_miss; l >= LEVEL_L2; l--) {
+        if (cache_fill(&h->cache[l], addr, &victim) && h->mode == INCLUSION_INCLUSIVE)
+            hier_back_invalidate(h, l, victim);
+    }
+    cache_fill(&h->cache[l1], addr, &victim);
+}
+
+static void hier_access_range(Hierarchy *h, int l1, unsigned long long addr, int len) {
+    unsigned long long bs = (unsigned long long)h->cache[l1].block_size;
+    unsigned long long last = addr + (unsigned long long)len - 1ULL;
+    for (unsigned long long b = addr / bs; b <= last / bs; b++)
+        hier_access(h, l1, b * bs);
+}
+
+void hier_replay(Hierarchy *h, const PhysRecord *recs, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const PhysRecord *r = &recs[i];
+
+        if (r->flags & PHYS_FLUSH_PAGE) {
+            // an evicted page frame leaves every level
+            for (int l = 0; l < h->num_levels; l++) {
+                unsigned long long bs = (unsigned long long)h->cache[l].block_size;
+                for (unsigned long long a = r->eip_pa; a < r->eip_pa + 4096ULL; a += bs)
+                    cache_invalidate(&h->cache[l], a);
+            }
+            continue;
+        }
+        h->total_instructions++;
+        h->instruction_bytes += r->len;
+        if (r->flags & PHYS_COUNT_ONLY)
+            continue;
+
+        if (r->flags & PHYS_EIP_MAPPED)
+            hier_access_range(h, LEVEL_L1I, r->eip_pa, r->len);
+        h->total_cycles += 2; // execute instruction
+
+        if (r->flags & PHYS_DST_USED) {
+            if (r->flags & PHYS_DST_MAPPED)
+                hier_access_range(h, LEVEL_L1D, r->dst_pa, 4);
+            h->total_cycles += 1; // effective address
+            h->srcdst_bytes += 4;
+        }
+        if (r->flags & PHYS_SRC_USED) {
+            if (r->flags & PHYS_SRC_MAPPED)
+                hier_access_range(h, LEVEL_L1D, r->src_pa, 4);
+            h->total_cycles += 1; // effective address
+            h->srcdst_bytes += 4;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include <stddef.h>
+
+#include "cachesim.h"
+
+// MULTI-LEVEL CACHE HIERARCHY
+//
+// Split L1 instruction and data caches in front of a unified L2 and an
+// optional L3. Every level has its own geometry, policy and lookup
+// latency; an access pays the latency of each level it probes plus the
+// memory latency if all of them miss.
+//
+//   inclusive      every fill goes into each level that missed; an L2/L3
+//                  eviction invalidates the block in the levels above
+//   exclusive      a block lives in one level: misses fill L1 only, a
+//                  lower-level hit moves the block up, L1 victims drop
+//                  into L2 and L2 victims into L3. L1I and L1D count as
+//                  one level: an L1 miss the other L1 holds is copied
+//                  across for an L2 lookup's latency, and a block in both
+//                  drops once the last copy goes
+//   non-inclusive  fills go into each level that missed, evictions are
+//                  independent (no back-invalidation)
+
+typedef enum {
+    INCLUSION_NINE = 0,          // non-inclusive non-exclusive
+    INCLUSION_INCLUSIVE = 1,
+    INCLUSION_EXCLUSIVE = 2
+} InclusionMode;
+
+enum { LEVEL_L1I, LEVEL_L1D, LEVEL_L2, LEVEL_L3, LEVEL_COUNT };
+
+typedef struct {
+    int size_kb;
+    int block_size;
+    int associativity;
+    ReplacementPolicy policy;
+    int latency;                 // cycles per lookup at this level
+} LevelConfig;
+
+typedef struct {
+    CacheSim cache[LEVEL_COUNT];
+    int latency[LEVEL_COUNT];
+    int num_levels;              // 3 without L3, 4 with
+    InclusionMode mode;
+    int mem_latency;             // cycles when every level misses
+    unsigned long long mem_accesses;
+    unsigned long long back_invalidations;
+    unsigned long long sibling_transfers;   // exclusive: L1 misses the other L1 held
+
+    // same instruction bookkeeping as a single CacheSim
+    unsigned long long instruction_bytes;
+    unsigned long long srcdst_bytes;
+    unsigned long long total_cycles;
+    unsigned long long total_instructions;
+} Hierarchy;
+
+// "KB:block:assoc[:policy[:latency]]", e.g. "256:64:8:lru:10". Fields
+// left out keep their value in *cfg. Returns 1 if OK, 0 if malformed
+int level_config_parse(const char *spec, LevelConfig *cfg);
+int inclusion_mode_parse(const char *opt, InclusionMode *mode);
+const char *inclusion_mode_name(InclusionMode mode);
+const char *level_name(int level);
+
+// cfg[LEVEL_L3] is only used when has_l3. Exclusive mode needs one block
+// size on every level; returns 0 (nothing allocated) if that is violated
+int hier_init(Hierarchy *h, const LevelConfig cfg[LEVEL_COUNT], int has_l3,
+              InclusionMode mode, int mem_latency);
+void hier_free(Hierarchy *h);
+void hier_seed(Hierarchy *h, unsigned long long seed);
+void hier_flush(Hierarchy *h);
+
+// Run a batch of translated instructions: fetches go to L1I, dstM/srcM
+// to L1D
+void hier_replay(Hierarchy *h, const PhysRecord *recs, size_t n);
+
+#endif
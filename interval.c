@@ -0,0 +1,128 @@
+#include "interval.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipeline.h"
+#include "tlb.h"
+
+int interval_parse(const char *spec, IntervalUnit *unit, unsigned long long *every) {
+    char buf[64];
+    if (strlen(spec) >= sizeof(buf)) return 0;
+    strcpy(buf, spec);
+
+    char *colon = strchr(buf, ':');
+    IntervalUnit u = INTERVAL_INSTRUCTIONS;
+    if (colon) {
+        *colon = '\0';
+        if (strcmp(colon + 1, "accesses") == 0) u = INTERVAL_ACCESSES;
+        else if (strcmp(colon + 1, "instructions") != 0) return 0;
+    }
+    char *end;
+    unsigned long long k = strtoull(buf, &end, 10);
+    if (end == buf || *end != '\0' || buf[0] == '-' || k == 0) return 0;
+    *unit = u;
+    *every = k;
+    return 1;
+}
+
+void interval_start(IntervalSampler *s, FILE *out, IntervalUnit unit,
+                    unsigned long long every, const VmStats *vm,
+                    const CacheSim *caches, int num_caches, const Hierarchy *hier) {
+    memset(s, 0, sizeof(*s));
+    s->out = out;
+    s->unit = unit;
+    s->every = every;
+    s->next = every;
+    s->vm = vm;
+    s->hier = hier;
+    s->caches = hier ? NULL : caches;
+    s->num_caches = hier ? 0 : num_caches;
+
+    fprintf(out, "instructions,page_table_hits,pages_from_free,page_faults,"
+                 "pages_evicted,virtual_pages_mapped");
+    if (vm->tlb)
+        fprintf(out, ",tlb_lookups,tlb_hits,tlb_walks");
+    if (hier) {
+        fprintf(out, ",cycles,memory_accesses");
+        for (int l = 0; l < hier->num_levels; l++) {
+            char name[8];
+            snprintf(name, sizeof(name), "%s", level_name(l));
+            for (char *p = name; *p; p++)
+                *p = (char)tolower((unsigned char)*p);
+            fprintf(out, ",%s_accesses,%s_hits,%s_misses,%s_writebacks",
+                    name, name, name, name);
+        }
+    }
+    for (int c = 0; c < s->num_caches; c++)
+        fprintf(out, ",c%d_accesses,c%d_hits,c%d_misses,c%d_writebacks,c%d_cycles",
+                c, c, c, c, c);
+    fprintf(out, "\n");
+}
+
+void interval_finish(IntervalSampler *s) {
+    if (interval_position(s) > s->last)
+        interval_sample(s);
+    fflush(s->out);
+}
+
+unsigned long long interval_position(const IntervalSampler *s) {
+    if (s->unit == INTERVAL_ACCESSES) {
+        if (s->hier)
+            return s->hier->cache[LEVEL_L1I].accesses + s->hier->cache[LEVEL_L1D].accesses;
+        return s->caches[0].accesses;
+    }
+    return s->hier ? s->hier->total_instructions : s->caches[0].total_instructions;
+}
+
+size_t interval_batch(const IntervalSampler *s, size_t max) {
+    unsigned long long pos = interval_position(s);
+    unsigned long long gap = s->next > pos ? s->next - pos : 1;
+    unsigned long long instructions = gap;
+    if (s->unit == INTERVAL_ACCESSES) {
+        // fewest instructions that could reach the sample point, at least one
+        instructions = gap / INTERVAL_MAX_ACCESSES;
+        if (instructions == 0) instructions = 1;
+    }
+    // a translate batch stops once an instruction's worth of records is
+    // not left, so this many records hold at most that many instructions
+    unsigned long long records = instructions + vm_max_records(s->vm) - 1;
+    return records < max ? (size_t)records : max;
+}
+
+void interval_sample(IntervalSampler *s) {
+    const VmStats *vm = s->vm;
+    FILE *out = s->out;
+    unsigned long long instructions =
+        s->hier ? s->hier->total_instructions : s->caches[0].total_instructions;
+    fprintf(out, "%llu,%llu,%llu,%llu,%llu,%llu", instructions, vm->page_table_hits,
+            vm->pages_from_free, vm->total_page_faults, vm->pages_evicted,
+            vm->virtual_pages_mapped);
+    if (vm->tlb) {
+        const Tlb *tlb = vm->tlb;
+        unsigned long long hits = 0;
+        for (int l = 0; l < tlb->num_levels; l++)
+            hits += tlb->level[l].hits;
+        fprintf(out, ",%llu,%llu,%llu", tlb->level[0].lookups, hits, tlb->walks);
+    }
+    if (s->hier) {
+        const Hierarchy *h = s->hier;
+        fprintf(out, ",%llu,%llu", h->total_cycles, h->mem_accesses);
+        for (int l = 0; l < h->num_levels; l++) {
+            const CacheSim *cs = &h->cache[l];
+            fprintf(out, ",%llu,%llu,%llu,%llu", cs->accesses, cs->hits, cs->misses,
+                    cs->writebacks);
+        }
+    }
+    for (int c = 0; c < s->num_caches; c++) {
+        const CacheSim *cs = &s->caches[c];
+        fprintf(out, ",%llu,%llu,%llu,%llu,%llu", cs->accesses, cs->hits, cs->misses,
+                cs->writebacks, cs->total_cycles);
+    }
+    fprintf(out, "\n");
+
+    unsigned long long pos = interval_position(s);
+    s->last = pos;
+    s->next = (pos / s->every + 1) * s->every;
+}
@@ -0,0 +1,72 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "cachesim.h"
+#include "hierarchy.h"
+#include "pagetable.h"
+
+// INTERVAL SAMPLING (--interval)
+//
+// Every K instructions, or K cache accesses, the run appends one CSV row
+// of cumulative counters to a side file: the VM counters, the TLB and,
+// per cache (c0, c1, ... of a sweep, or l1i/l1d/l2/l3 of a hierarchy),
+// accesses, hits, misses, writebacks and cycles. The slope between rows
+// shows the phases a whole-run average hides. The last row holds the
+// final totals.
+//
+// The loop checks the position once per batch against the next sample
+// point. The serial loops end each translate batch at the next sample
+// point (interval_batch), so the VM and cache columns of a row describe
+// the same instruction. Instruction samples land exactly on multiples of
+// K; access samples land on the first instruction boundary at or past
+// them.
+
+typedef enum {
+    INTERVAL_INSTRUCTIONS = 0,
+    INTERVAL_ACCESSES = 1        // cache block accesses of c0 / L1I + L1D
+} IntervalUnit;
+
+// Cache block accesses one instruction can make: a fetch over three
+// 8-byte blocks, then dstM and srcM over two each
+#define INTERVAL_MAX_ACCESSES 7
+
+typedef struct {
+    FILE *out;
+    IntervalUnit unit;
+    unsigned long long every;    // K
+    unsigned long long next;     // position of the next row
+    unsigned long long last;     // position of the last row written
+
+    const VmStats *vm;
+    const CacheSim *caches;      // the sweep's caches, NULL with a hierarchy
+    int num_caches;
+    const Hierarchy *hier;
+} IntervalSampler;
+
+// "K[:instructions/accesses]", e.g. "100000" or "50000:accesses".
+// Returns 1 if OK, 0 if malformed
+int interval_parse(const char *spec, IntervalUnit *unit, unsigned long long *every);
+
+// Write the header to out; caches is ignored when hier is given
+void interval_start(IntervalSampler *s, FILE *out, IntervalUnit unit,
+                    unsigned long long every, const VmStats *vm,
+                    const CacheSim *caches, int num_caches, const Hierarchy *hier);
+// Write the final row if the run went past the last one; out stays open
+void interval_finish(IntervalSampler *s);
+
+unsigned long long interval_position(const IntervalSampler *s);
+// Records to translate before the next sample point, at most max
+size_t interval_batch(const IntervalSampler *s, size_t max);
+// Write a row and move to the next sample point past the position
+void interval_sample(IntervalSampler *s);
+
+// After each replayed batch: a row once the sample point is reached
+static inline void interval_check(IntervalSampler *s) {
+    if (s && interval_position(s) >= s->next)
+        interval_sample(s);
+}
+
+#endif
@@ -0,0 +1,341 @@
+#include "pagetable.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tlb.h"
+
+// Initialize page table
+void pt_init(PageTable* pt) {
+    pt->arr = NULL;
+    pt->used = 0;
+    pt->cap = 0;
+    pt->dir = NULL;
+    pt->dir_len = 0;
+    pt->asid = 0;
+    pt->page_faults = 0;
+    pt->tlb_cycles = 0;
+}
+
+// Free page table memory
+void pt_free(PageTable* pt) {
+    for (size_t i = 0; i < pt->dir_len; i++)
+        free(pt->dir[i]);
+    free(pt->dir);
+    free(pt->arr);
+    pt_init(pt);
+}
+
+// Only touched 4 MB regions have a leaf, so this grows with the pages a
+// process maps rather than with its virtual address space
+size_t pt_bytes(const PageTable* pt) {
+    size_t bytes = pt->dir_len * sizeof(uint32_t*) + pt->cap * sizeof(MapEntry);
+    for (size_t i = 0; i < pt->dir_len; i++) {
+        if (pt->dir[i])
+            bytes += PT_LEAF_SIZE * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+// Radix lookup for VPN in page table, O(1) regardless of pages mapped
+long pt_find(const PageTable* pt, unsigned long long vpn) {
+    unsigned long long hi = vpn >> PT_LEAF_BITS;
+    if (hi >= pt->dir_len || !pt->dir[hi])
+        return -1; // not found
+    uint32_t slot = pt->dir[hi][vpn & (PT_LEAF_SIZE - 1)];
+    if (slot & PT_EVICTED)
+        return -1;
+    return (long)slot - 1;
+}
+
+// Make sure the leaf covering vpn exists and return it
+static uint32_t* pt_leaf(PageTable* pt, unsigned long long vpn) {
+    unsigned long long hi = vpn >> PT_LEAF_BITS;
+    if (hi >= pt->dir_len) {
+        size_t new_len = (pt->dir_len == 0)
+                             ? (size_t)(VA_PAGES_PER_PROC >> PT_LEAF_BITS)
+                             : pt->dir_len;
+        while (new_len <= hi)
+            new_len *= 2;
+        uint32_t** tmp = (uint32_t**)realloc(pt->dir, new_len * sizeof(uint32_t*));
+        if (!tmp) {
+            fprintf(stderr, "Error: Memory allocation failed in pt_push.\n");
+            exit(1);
+        }
+        memset(tmp + pt->dir_len, 0, (new_len - pt->dir_len) * sizeof(uint32_t*));
+        pt->dir = tmp;
+        pt->dir_len = new_len;
+    }
+    if (!pt->dir[hi]) {
+        pt->dir[hi] = (uint32_t*)calloc(PT_LEAF_SIZE, sizeof(uint32_t));
+        if (!pt->dir[hi]) {
+            fprintf(stderr, "Error: Memory allocation failed in pt_push.\n");
+            exit(1);
+        }
+    }
+    return pt->dir[hi];
+}
+
+// Add a new mapping to the page table, or bring an evicted page back
+void pt_push(PageTable* pt, unsigned long long vpn, unsigned long long ppn) {
+    uint32_t* leaf = pt_leaf(pt, vpn);
+    uint32_t* slot = &leaf[vpn & (PT_LEAF_SIZE - 1)];
+    if (*slot & PT_EVICTED) {
+        *slot &= ~PT_EVICTED;
+        pt->arr[*slot - 1].ppn = ppn;
+        return;
+    }
+    if (pt->used == pt->cap) {
+        size_t new_cap = (pt->cap == 0) ? 1 : pt->cap * 2;
+        MapEntry* tmp = (MapEntry*)realloc(pt->arr, new_cap * sizeof(MapEntry));
+        if (!tmp) {
+            fprintf(stderr, "Error: Memory allocation failed in pt_push.\n");
+            exit(1);
+        }
+        pt->arr = tmp;
+        pt->cap = new_cap;
+    }
+    pt->arr[pt->used].vpn = vpn;
+    pt->arr[pt->used].ppn = ppn;
+    pt->used++;
+    *slot = (uint32_t)pt->used;
+}
+
+// Unmap a resident page, its entry stays for when it is paged back in
+void pt_evict(PageTable* pt, unsigned long long vpn) {
+    unsigned long long hi = vpn >> PT_LEAF_BITS;
+    if (hi >= pt->dir_len || !pt->dir[hi])
+        return;
+    uint32_t* slot = &pt->dir[hi][vpn & (PT_LEAF_SIZE - 1)];
+    if (*slot != 0)
+        *slot |= PT_EVICTED;
+}
+
+// FRAME TABLE
+
+void frames_init(FrameTable* ft, PageReplacement policy, PageTable* pts,
+                 unsigned long long first_ppn, unsigned long long num_frames,
+                 unsigned long long seed) {
+    ft->frames = (Frame*)calloc(num_frames ? num_frames : 1, sizeof(Frame));
+    if (!ft->frames) {
+        fprintf(stderr, "Error: frames_init out of memory.\n");
+        exit(1);
+    }
+    for (unsigned long long f = 0; f < num_frames; f++)
+        ft->frames[f].asid = -1;
+    ft->first_ppn = first_ppn;
+    ft->num_frames = num_frames;
+    ft->policy = policy;
+    ft->pts = pts;
+    ft->hand = 0;
+    ft->ticks = 0;
+    ft->rng_state = seed * 0x9E3779B97F4A7C15ULL + 1ULL;
+    ft->num_pinned = 0;
+}
+
+void frames_free(FrameTable* ft) {
+    free(ft->frames);
+    ft->frames = NULL;
+    ft->num_frames = 0;
+}
+
+const char* page_repl_name(PageReplacement policy) {
+    switch (policy) {
+    case PAGE_REPL_NONE:   return "None";
+    case PAGE_REPL_FIFO:   return "FIFO";
+    case PAGE_REPL_CLOCK:  return "Clock";
+    case PAGE_REPL_LRU:    return "LRU (aging)";
+    case PAGE_REPL_RANDOM: return "Random";
+    }
+    return "";
+}
+
+// Parse a --page-repl option. Returns 1 if OK, 0 if unknown
+int page_repl_parse(const char* opt, PageReplacement* policy) {
+    if (strcmp(opt, "fifo") == 0) {
+        *policy = PAGE_REPL_FIFO;
+    } else if (strcmp(opt, "clock") == 0) {
+        *policy = PAGE_REPL_CLOCK;
+    } else if (strcmp(opt, "lru") == 0) {
+        *policy = PAGE_REPL_LRU;
+    } else if (strcmp(opt, "random") == 0 || strcmp(opt, "rnd") == 0) {
+        *policy = PAGE_REPL_RANDOM;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// LRU aging pass: shift every frame's history and fold in its R bit.
+// Running it once per num_frames references keeps it O(1) per access
+static void frames_age(FrameTable* ft) {
+    for (unsigned long long f = 0; f < ft->num_frames; f++) {
+        Frame* fr = &ft->frames[f];
+        fr->age = (uint8_t)((fr->age >> 1) | (fr->referenced << 7));
+        fr->referenced = 0;
+    }
+    ft->ticks = 0;
+}
+
+static void frames_pin(FrameTable* ft, unsigned long long f) {
+    for (int i = 0; i < ft->num_pinned; i++) {
+        if (ft->pinned[i] == f)
+            return;
+    }
+    if (ft->num_pinned < VM_MAX_EVICT)
+        ft->pinned[ft->num_pinned++] = f;
+}
+
+static int frames_pinned(const FrameTable* ft, unsigned long long f) {
+    for (int i = 0; i < ft->num_pinned; i++) {
+        if (ft->pinned[i] == f)
+            return 1;
+    }
+    return 0;
+}
+
+void vm_begin_instruction(VmStats* vm) {
+    vm->num_evicted = 0;
+    if (vm->frames)
+        vm->frames->num_pinned = 0;
+}
+
+void vm_reference(VmStats* vm, unsigned long long ppn) {
+    FrameTable* ft = vm->frames;
+    if (!ft)
+        return;
+    frames_pin(ft, ppn - ft->first_ppn);
+    ft->frames[ppn - ft->first_ppn].referenced = 1;
+    if (ft->policy == PAGE_REPL_LRU && ++ft->ticks >= ft->num_frames)
+        frames_age(ft);
+}
+
+// Frame to reuse, by policy, never one the faulting instruction pinned
+static unsigned long long frames_victim(FrameTable* ft) {
+    unsigned long long n = ft->num_frames;
+    unsigned long long v;
+    // with every frame pinned (fewer frames than the instruction's pages)
+    // one of them has to go
+    int skip = (unsigned long long)ft->num_pinned < n;
+    switch (ft->policy) {
+    case PAGE_REPL_CLOCK:
+        // clear R bits until a frame without one comes round
+        while (ft->frames[ft->hand].referenced ||
+               (skip && frames_pinned(ft, ft->hand))) {
+            ft->frames[ft->hand].referenced = 0;
+            ft->hand = (ft->hand + 1) % n;
+        }
+        v = ft->hand;
+        break;
+    case PAGE_REPL_LRU: {
+        // lowest (history, R) from the hand, so ties rotate
+        v = ft->hand;
+        unsigned int best = 0x200U;  // above every key, so a frame is picked
+        for (unsigned long long i = 0; i < n; i++) {
+            unsigned long long f = (ft->hand + i) % n;
+            if (skip && frames_pinned(ft, f))
+                continue;
+            unsigned int key = ((unsigned int)ft->frames[f].age << 1) |
+                               ft->frames[f].referenced;
+            if (key < best) {
+                best = key;
+                v = f;
+                if (key == 0) break;
+            }
+        }
+        break;
+    }
+    case PAGE_REPL_RANDOM: {
+        unsigned long long x = ft->rng_state;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        ft->rng_state = x;
+        v = ((x * 0x2545F4914F6CDD1DULL) >> 32) % n;
+        while (skip && frames_pinned(ft, v))
+            v = (v + 1) % n;
+        return v;
+    }
+    default:
+        // FIFO: frames are handed out and replaced in PPN order, so the
+        // oldest resident page is always the one under the hand
+        v = ft->hand;
+        while (skip && frames_pinned(ft, v))
+            v = (v + 1) % n;
+        break;
+    }
+    ft->hand = (v + 1) % n;
+    return v;
+}
+
+// Evict a page and return its frame's PPN for the faulting page
+static unsigned long long vm_evict(VmStats* vm) {
+    FrameTable* ft = vm->frames;
+    Frame* fr = &ft->frames[frames_victim(ft)];
+    unsigned long long ppn = ft->first_ppn + (unsigned long long)(fr - ft->frames);
+
+    pt_evict(&ft->pts[fr->asid], fr->vpn);
+    if (vm->tlb)
+        tlb_invalidate(vm->tlb, fr->asid, fr->vpn);
+    if (vm->flush_evicted && vm->num_evicted < VM_MAX_EVICT)
+        vm->evicted_ppn[vm->num_evicted++] = ppn;
+    vm->pages_evicted++;
+    return ppn;
+}
+
+static void frames_assign(VmStats* vm, unsigned long long ppn, const PageTable* pt,
+                          unsigned long long vpn) {
+    FrameTable* ft = vm->frames;
+    if (!ft)
+        return;
+    frames_pin(ft, ppn - ft->first_ppn);
+    Frame* fr = &ft->frames[ppn - ft->first_ppn];
+    fr->asid = pt->asid;
+    fr->vpn = (uint32_t)vpn;
+    fr->referenced = 1;
+    fr->age = 0;
+}
+
+/* Touch one virtual page: update stats + maybe map from free */
+long vm_touch_page(PageTable* pt, unsigned long long vpn, VmStats* vm) {
+    long idx = pt_find(pt, vpn);
+    if (idx >= 0) {
+        vm->page_table_hits++;
+        vm_reference(vm, pt->arr[idx].ppn);
+    } else {
+        unsigned long long ppn;
+        if (vm->free_ppn_left > 0) {
+            ppn = vm->next_ppn;
+            vm->next_ppn++;
+            vm->free_ppn_left--;
+            vm->pages_from_free++;
+        } else {
+            vm->total_page_faults++;
+            pt->page_faults++;
+            if (!vm->frames || vm->frames->num_frames == 0) {
+                vm->virtual_pages_mapped++;
+                return -1;
+            }
+            ppn = vm_evict(vm);
+        }
+        pt_push(pt, vpn, ppn);
+        idx = pt_find(pt, vpn);
+        frames_assign(vm, ppn, pt, vpn);
+    }
+    vm->virtual_pages_mapped++;
+    return idx;
+}
+
+// Translate VA -> PA if mapped. Return 1 if OK, 0 if unmapped
+int vm_translate(const PageTable* pt,
+                 unsigned long long vaddr,
+                 unsigned long long* paddr_out) {
+    unsigned long long vpn = vaddr >> 12;
+    unsigned long long offset = vaddr & (PAGE_SIZE - 1);
+    long idx = pt_find(pt, vpn);
+    if (idx < 0) return 0;
+    unsigned long long ppn = pt->arr[idx].ppn;
+    *paddr_out = (ppn << 12) | offset;
+    return 1;
+}
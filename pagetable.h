@@ -0,0 +1,130 @@
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAGE_SIZE 4096
+#define VA_PAGES_PER_PROC (512ULL * 1024ULL)
+
+// radix split of the VPN: low PT_LEAF_BITS pick the slot inside a leaf,
+// the remaining high bits pick the leaf from the directory
+#define PT_LEAF_BITS 10
+#define PT_LEAF_SIZE (1U << PT_LEAF_BITS)
+#define PT_EVICTED 0x80000000U     // dir slot flag: entry kept, page not resident
+
+#define VM_MAX_EVICT 4             // pages one instruction can touch
+
+// PAGE TABLE STRUCTS (Milestone 2)
+
+struct Tlb;
+
+typedef struct {
+    unsigned long long vpn;    // virtual page number
+    unsigned long long ppn;    // physical page number
+} MapEntry;
+
+typedef struct {
+    MapEntry* arr;             // array of entries, in mapping order
+    size_t used;               // number of entries (pages ever mapped)
+    size_t cap;                // capacity of the array
+
+    // two-level radix index: dir[vpn >> PT_LEAF_BITS][vpn & (PT_LEAF_SIZE-1)]
+    // holds (index into arr) + 1, 0 means never mapped; PT_EVICTED is set
+    // while the page is out of memory
+    uint32_t** dir;
+    size_t dir_len;
+
+    int asid;                  // address space id, tags this process's TLB entries
+    unsigned long long page_faults;   // this process's share of the VmStats
+    unsigned long long tlb_cycles;
+} PageTable;
+
+// PAGE REPLACEMENT once the free frames run out
+
+typedef enum {
+    PAGE_REPL_NONE = 0,        // Milestone 2: the fault is counted, nothing is mapped
+    PAGE_REPL_FIFO = 1,
+    PAGE_REPL_CLOCK = 2,       // second chance on the referenced bit
+    PAGE_REPL_LRU = 3,         // aging: 8-bit reference history per frame
+    PAGE_REPL_RANDOM = 4
+} PageReplacement;
+
+typedef struct {
+    int asid;                  // owning process, -1 = free
+    uint32_t vpn;
+    uint8_t referenced;        // set on every access to the page
+    uint8_t age;               // LRU: reference history, MSB = last period
+} Frame;
+
+// Global frame table: PPN -> (process, VPN), so a victim can be unmapped
+typedef struct {
+    Frame* frames;             // [num_frames], frame f is PPN first_ppn + f
+    unsigned long long first_ppn;
+    unsigned long long num_frames;
+    PageReplacement policy;
+    PageTable* pts;            // page tables indexed by ASID
+    unsigned long long hand;   // FIFO/clock position
+    unsigned long long ticks;  // LRU: references since the last aging pass
+    unsigned long long rng_state;
+
+    // frames the current instruction already touched: a later fault of
+    // the same instruction must not evict them (unless every frame is one)
+    unsigned long long pinned[VM_MAX_EVICT];
+    int num_pinned;
+} FrameTable;
+
+// Milestone 2 counters shared by all processes
+typedef struct {
+    unsigned long long page_table_hits;
+    unsigned long long pages_from_free;
+    unsigned long long total_page_faults;
+    unsigned long long virtual_pages_mapped;
+
+    unsigned long long free_ppn_left;   // user pages not handed out yet
+    unsigned long long next_ppn;
+
+    struct Tlb* tlb;           // translations go through it, NULL = none
+    int running_asid;          // process of the last translated instruction
+    int flush_tlb_on_switch;   // no ASIDs: flush the TLB on a context switch
+    FrameTable* frames;        // page replacement, NULL = none
+    unsigned long long pages_evicted;
+
+    // frames evicted by the current instruction, when the caches flush them
+    int flush_evicted;
+    int num_evicted;
+    unsigned long long evicted_ppn[VM_MAX_EVICT];
+} VmStats;
+
+void pt_init(PageTable* pt);
+void pt_free(PageTable* pt);
+long pt_find(const PageTable* pt, unsigned long long vpn);
+void pt_push(PageTable* pt, unsigned long long vpn, unsigned long long ppn);
+void pt_evict(PageTable* pt, unsigned long long vpn);
+// Bytes this table actually holds: directory, allocated leaves, entry array
+size_t pt_bytes(const PageTable* pt);
+
+// Frames first_ppn .. first_ppn + num_frames - 1 are the user's
+void frames_init(FrameTable* ft, PageReplacement policy, PageTable* pts,
+                 unsigned long long first_ppn, unsigned long long num_frames,
+                 unsigned long long seed);
+void frames_free(FrameTable* ft);
+const char* page_repl_name(PageReplacement policy);
+int page_repl_parse(const char* opt, PageReplacement* policy);
+
+// A new instruction starts: nothing evicted or pinned by it yet
+void vm_begin_instruction(VmStats* vm);
+// Mark the page in ppn referenced (clock/LRU bookkeeping) and pin it
+// for the rest of the instruction
+void vm_reference(VmStats* vm, unsigned long long ppn);
+
+/* Touch one virtual page: update stats + maybe map from free.
+   Returns the mapping's index in pt->arr, -1 on a page fault */
+long vm_touch_page(PageTable* pt, unsigned long long vpn, VmStats* vm);
+
+// Translate VA -> PA if mapped. Return 1 if OK, 0 if unmapped
+int vm_translate(const PageTable* pt,
+                 unsigned long long vaddr,
+                 unsigned long long* paddr_out);
+
+#endif
@@ -0,0 +1,443 @@
+#include "pipeline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "profile.h"
+#include "tlb.h"
+
+#define VM_PARSE_CHUNK 256       // instructions parsed before they are translated
+
+// Touch one page through the TLB (if any) and return its PPN, -1 if it
+// could not be mapped
+static long vm_access_page(PageTable *pt, VmStats *vm, unsigned long long vpn) {
+    if (vm->tlb) {
+        unsigned long long cycles = vm->tlb->cycles;
+        long ppn = tlb_lookup(vm->tlb, pt->asid, vpn);
+        pt->tlb_cycles += vm->tlb->cycles - cycles;
+        if (ppn >= 0) {
+            // the TLB holds mapped pages only: a page-table hit
+            vm->page_table_hits++;
+            vm->virtual_pages_mapped++;
+            vm_reference(vm, (unsigned long long)ppn);
+            return ppn;
+        }
+    }
+    long idx = vm_touch_page(pt, vpn, vm);
+    if (idx < 0)
+        return -1;
+    unsigned long long ppn = pt->arr[idx].ppn;
+    if (vm->tlb)
+        tlb_fill(vm->tlb, pt->asid, vpn, ppn);
+    return (long)ppn;
+}
+
+static uint32_t vm_phys_addr(long ppn, unsigned long long vaddr) {
+    return (uint32_t)(((unsigned long long)ppn << 12) | (vaddr & (PAGE_SIZE - 1)));
+}
+
+// PPN of vaddr's page after all of an instruction's touches
+static long vm_resident_ppn(const PageTable *pt, unsigned long long vaddr) {
+    long idx = pt_find(pt, vaddr >> 12);
+    return (idx < 0) ? -1 : (long)pt->arr[idx].ppn;
+}
+
+size_t vm_translate_record(PageTable *pt, VmStats *vm,
+                           const TraceRecord *rec, PhysRecord *out) {
+    unsigned long long eip_addr = rec->eip;
+    int eip_len = rec->len;
+    int dst_used = rec->dst_valid && rec->dst != 0;
+    int src_used = rec->src_valid && rec->src != 0;
+    unsigned long long evicted_before = vm->pages_evicted;
+    vm_begin_instruction(vm);
+
+    // first instruction after a context switch
+    if (pt->asid != vm->running_asid) {
+        if (vm->tlb && vm->flush_tlb_on_switch)
+            tlb_flush(vm->tlb);
+        vm->running_asid = pt->asid;
+    }
+
+    // VM: touch instruction pages, the fetch translates with the first
+    PROFILE_SAMPLE_BEGIN(PROFILE_TOUCH, touch);
+    unsigned long long first_vpn = eip_addr >> 12;
+    unsigned long long last_vpn =
+        (eip_addr + (unsigned long long)eip_len - 1ULL) >> 12;
+    long eip_ppn = vm_access_page(pt, vm, first_vpn);
+    for (unsigned long long vpn = first_vpn + 1; vpn <= last_vpn; vpn++) {
+        vm_access_page(pt, vm, vpn);
+    }
+
+    long dst_ppn = dst_used ? vm_access_page(pt, vm, rec->dst >> 12) : -1;
+    long src_ppn = src_used ? vm_access_page(pt, vm, rec->src >> 12) : -1;
+
+    // a later touch may have evicted an earlier page of this instruction,
+    // translate with what is resident now (unchanged without evictions)
+    if (vm->pages_evicted != evicted_before) {
+        eip_ppn = vm_resident_ppn(pt, eip_addr);
+        dst_ppn = dst_used ? vm_resident_ppn(pt, rec->dst) : -1;
+        src_ppn = src_used ? vm_resident_ppn(pt, rec->src) : -1;
+    }
+    PROFILE_SAMPLE_END(PROFILE_TOUCH, touch);
+
+    // evicted frames leave the caches before the instruction runs
+    for (int e = 0; e < vm->num_evicted; e++) {
+        out->eip_pa = (uint32_t)(vm->evicted_ppn[e] << 12);
+        out->dst_pa = out->src_pa = 0;
+        out->len = 0;
+        out->flags = PHYS_FLUSH_PAGE;
+        out->eip = 0;
+        out++;
+    }
+
+    // translate for the cache stage
+    out->len = (uint8_t)eip_len;
+    out->flags = 0;
+    out->eip_pa = out->dst_pa = out->src_pa = 0;
+    out->eip = (uint32_t)eip_addr;
+    if (eip_ppn >= 0) {
+        out->eip_pa = vm_phys_addr(eip_ppn, eip_addr);
+        out->flags |= PHYS_EIP_MAPPED;
+    }
+    if (dst_used) {
+        out->flags |= PHYS_DST_USED;
+        if (dst_ppn >= 0) {
+            out->dst_pa = vm_phys_addr(dst_ppn, rec->dst);
+            out->flags |= PHYS_DST_MAPPED;
+        }
+    }
+    if (src_used) {
+        out->flags |= PHYS_SRC_USED;
+        if (src_ppn >= 0) {
+            out->src_pa = vm_phys_addr(src_ppn, rec->src);
+            out->flags |= PHYS_SRC_MAPPED;
+        }
+    }
+    return (size_t)vm->num_evicted + 1;
+}
+
+// The instruction past the -n limit is counted but not simulated
+static void vm_count_only(const TraceRecord *rec, PhysRecord *out) {
+    out->len = (uint8_t)rec->len;
+    out->flags = PHYS_COUNT_ONLY;
+}
+
+// Parse up to want instructions of tr. Sets *done if the trace ran out
+static size_t vm_parse_chunk(TraceReader *tr, TraceRecord *recs, size_t want, int *done) {
+    PROFILE_BEGIN(t);
+    size_t got = 0;
+    while (got < want && trace_next(tr, &recs[got]))
+        got++;
+    if (got < want)
+        *done = 1;
+    PROFILE_END(PROFILE_PARSE, t, got);
+    return got;
+}
+
+// Instructions to parse next so their records fit in [n, max)
+static size_t vm_chunk_size(const VmStats *vm, size_t n, size_t max) {
+    size_t want = (max - n) / vm_max_records(vm);
+    return (want < VM_PARSE_CHUNK) ? want : VM_PARSE_CHUNK;
+}
+
+size_t vm_translate_batch(TraceReader *tr, PageTable *pt, VmStats *vm,
+                          int instruction_limit, int *instructions_seen,
+                          int *done, PhysRecord *out, size_t max) {
+    TraceRecord recs[VM_PARSE_CHUNK];
+    size_t n = 0;
+    while (!*done && n + vm_max_records(vm) <= max) {
+        size_t want = vm_chunk_size(vm, n, max);
+        if (instruction_limit != -1 &&
+            want > (size_t)(instruction_limit - *instructions_seen) + 1)
+            want = (size_t)(instruction_limit - *instructions_seen) + 1;
+        size_t got = vm_parse_chunk(tr, recs, want, done);
+
+        PROFILE_BEGIN(t);
+        for (size_t i = 0; i < got; i++) {
+            (*instructions_seen)++;
+
+            // simple time-slice: stop if over limit, the instruction is counted
+            if (instruction_limit != -1 && *instructions_seen > instruction_limit) {
+                vm_count_only(&recs[i], &out[n]);
+                n++;
+                *done = 1;
+                break;
+            }
+
+            n += vm_translate_record(pt, vm, &recs[i], &out[n]);
+        }
+        PROFILE_END(PROFILE_TRANSLATE, t, got);
+    }
+    return n;
+}
+
+size_t vm_translate_slice(TraceReader *tr, PageTable *pt, VmStats *vm, int *left,
+                          int *done, PhysRecord *out, size_t max) {
+    TraceRecord recs[VM_PARSE_CHUNK];
+    size_t n = 0;
+    while (!*done && *left > 0 && n + vm_max_records(vm) <= max) {
+        size_t want = vm_chunk_size(vm, n, max);
+        if (want > (size_t)*left)
+            want = (size_t)*left;
+        size_t got = vm_parse_chunk(tr, recs, want, done);
+        *left -= (int)got;
+
+        PROFILE_BEGIN(t);
+        for (size_t i = 0; i < got; i++)
+            n += vm_translate_record(pt, vm, &recs[i], &out[n]);
+        PROFILE_END(PROFILE_TRANSLATE, t, got);
+    }
+    return n;
+}
+
+// PIPELINE
+
+static double pipe_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void *pipe_alloc(size_t n, size_t size) {
+    void *ptr = calloc(n, size);
+    if (!ptr) {
+        fprintf(stderr, "Error: pipeline out of memory.\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+static ParseBatch *parse_take(Pipeline *p) {
+    ParseBatch *b;
+    spsc_pop_wait(&p->parse_free, &b, 1);
+    b->n = 0;
+    b->file = -1;
+    b->end = 0;
+    return b;
+}
+
+// Parse up to left records of trace f into batches. Returns 1 at its end
+static int parse_run(Pipeline *p, TraceReader *tr, int f, unsigned long long left) {
+    PipeStageStats *st = &p->stats[PIPE_PARSE];
+    int eof = 0;
+    while (!eof && left > 0) {
+        ParseBatch *b = parse_take(p);
+        b->file = f;
+        double t0 = pipe_now();
+        PROFILE_BEGIN(t);
+        while (b->n < PIPE_BATCH && left > 0) {
+            if (!trace_next(tr, &b->recs[b->n])) {
+                eof = 1;
+                break;
+            }
+            b->n++;
+            left--;
+        }
+        PROFILE_END(PROFILE_PARSE, t, b->n);
+        st->busy_sec += pipe_now() - t0;
+        st->records += b->n;
+        st->batches++;
+        spsc_push_all(&p->parsed, &b, 1);
+    }
+    return eof;
+}
+
+static void *parse_main(void *arg) {
+    Pipeline *p = (Pipeline *)arg;
+    PipeStageStats *st = &p->stats[PIPE_PARSE];
+    double start = pipe_now();
+
+    TraceSet *ts = p->traces;
+    if (p->slice > 0) {
+        // round robin, one slice per turn, until every trace has ended
+        int live = ts->count;
+        for (int f = 0; live > 0; f = (f + 1) % ts->count) {
+            if (!trace_set_live(ts, f))
+                continue;
+            TraceReader *tr = trace_set_reader(ts, f);
+            if (!tr || parse_run(p, tr, f, (unsigned long long)p->slice)) {
+                trace_set_end(ts, f);
+                live--;
+            }
+        }
+    } else {
+        // the serial loop reads at most limit + 1 instructions per trace
+        unsigned long long left = (p->instruction_limit == -1)
+                                      ? ~0ULL
+                                      : (unsigned long long)p->instruction_limit + 1ULL;
+        for (int f = 0; f < ts->count; f++) {
+            TraceReader *tr = trace_set_reader(ts, f);
+            if (tr)
+                parse_run(p, tr, f, left);
+            trace_set_end(ts, f);
+        }
+    }
+
+    ParseBatch *b = parse_take(p);
+    b->end = 1;
+    spsc_push_all(&p->parsed, &b, 1);
+    st->total_sec = pipe_now() - start;
+    return NULL;
+}
+
+static void *translate_main(void *arg) {
+    Pipeline *p = (Pipeline *)arg;
+    PipeStageStats *st = &p->stats[PIPE_TRANSLATE];
+    double start = pipe_now();
+    int file = -1;
+    int instructions_seen = 0;
+
+    for (;;) {
+        ParseBatch *in;
+        PhysBatch *out;
+        spsc_pop_wait(&p->parsed, &in, 1);
+        spsc_pop_wait(&p->phys_free, &out, 1);
+        out->n = 0;
+        out->end = 0;
+        out->file = in->file;
+
+        double t0 = pipe_now();
+        PROFILE_BEGIN(t);
+        if (in->file != file) {
+            file = in->file;
+            instructions_seen = 0;
+        }
+        for (size_t i = 0; i < in->n; i++) {
+            // page flushes can make the output outgrow the input batch
+            if (out->n + VM_MAX_RECORDS > PIPE_BATCH) {
+                st->records += out->n;
+                st->batches++;
+                spsc_push_all(&p->translated, &out, 1);
+                spsc_pop_wait(&p->phys_free, &out, 1);
+                out->n = 0;
+                out->end = 0;
+                out->file = in->file;
+            }
+            instructions_seen++;
+            if (p->slice == 0 && p->instruction_limit != -1 &&
+                instructions_seen > p->instruction_limit) {
+                vm_count_only(&in->recs[i], &out->recs[out->n]);
+                out->n++;
+            } else {
+                out->n += vm_translate_record(&p->pt[file], p->vm, &in->recs[i],
+                                              &out->recs[out->n]);
+            }
+        }
+        out->end = in->end;
+        if (!in->end) {
+            PROFILE_END(PROFILE_TRANSLATE, t, in->n);
+            st->busy_sec += pipe_now() - t0;
+            st->records += out->n;
+            st->batches++;
+        }
+
+        int end = in->end;
+        spsc_push_all(&p->parse_free, &in, 1);
+        spsc_push_all(&p->translated, &out, 1);
+        if (end)
+            break;
+    }
+    st->total_sec = pipe_now() - start;
+    return NULL;
+}
+
+void pipeline_start(Pipeline *p, TraceSet *traces, PageTable *pt,
+                    int instruction_limit, int slice, VmStats *vm) {
+    p->traces = traces;
+    p->slice = slice;
+    p->pt = pt;
+    p->instruction_limit = instruction_limit;
+    p->vm = vm;
+    for (int s = 0; s < PIPE_STAGES; s++) {
+        p->stats[s].batches = p->stats[s].records = 0;
+        p->stats[s].busy_sec = p->stats[s].total_sec = 0.0;
+    }
+
+    p->parse_bufs = (ParseBatch *)pipe_alloc(PIPE_DEPTH, sizeof(ParseBatch));
+    p->phys_bufs = (PhysBatch *)pipe_alloc(PIPE_DEPTH, sizeof(PhysBatch));
+    spsc_init(&p->parsed, PIPE_DEPTH, sizeof(ParseBatch *));
+    spsc_init(&p->parse_free, PIPE_DEPTH, sizeof(ParseBatch *));
+    spsc_init(&p->translated, PIPE_DEPTH, sizeof(PhysBatch *));
+    spsc_init(&p->phys_free, PIPE_DEPTH, sizeof(PhysBatch *));
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+        ParseBatch *pb = &p->parse_bufs[i];
+        PhysBatch *xb = &p->phys_bufs[i];
+        spsc_push_all(&p->parse_free, &pb, 1);
+        spsc_push_all(&p->phys_free, &xb, 1);
+    }
+
+    p->cache_start = p->cache_mark = pipe_now();
+    if (pthread_create(&p->parse_thread, NULL, parse_main, p) != 0 ||
+        pthread_create(&p->translate_thread, NULL, translate_main, p) != 0) {
+        fprintf(stderr, "Error: cannot create pipeline threads.\n");
+        exit(1);
+    }
+}
+
+const PhysBatch *pipeline_next(Pipeline *p) {
+    PhysBatch *b;
+    spsc_pop_wait(&p->translated, &b, 1);
+    if (b->end) {
+        p->stats[PIPE_CACHE].total_sec = pipe_now() - p->cache_start;
+        spsc_push_all(&p->phys_free, &b, 1);
+        return NULL;
+    }
+    p->cache_mark = pipe_now();
+    return b;
+}
+
+void pipeline_release(Pipeline *p, const PhysBatch *b) {
+    PipeStageStats *st = &p->stats[PIPE_CACHE];
+    st->busy_sec += pipe_now() - p->cache_mark;
+    st->records += b->n;
+    st->batches++;
+    PhysBatch *mut = (PhysBatch *)b;
+    spsc_push_all(&p->phys_free, &mut, 1);
+}
+
+void pipeline_finish(Pipeline *p) {
+    pthread_join(p->parse_thread, NULL);
+    pthread_join(p->translate_thread, NULL);
+    spsc_free(&p->parsed);
+    spsc_free(&p->parse_free);
+    spsc_free(&p->translated);
+    spsc_free(&p->phys_free);
+    free(p->parse_bufs);
+    free(p->phys_bufs);
+    p->parse_bufs = NULL;
+    p->phys_bufs = NULL;
+}
+
+static const char *stage_names[PIPE_STAGES] = {"parse", "translate", "cache"};
+
+void pipeline_print_stats(const Pipeline *p) {
+    printf("\n***** PIPELINE STAGE THROUGHPUT *****\n\n");
+    printf("Stage\t\tRecords\t\tBatches\tBusy(s)\tStalled(s)\tMrec/s busy\n");
+    for (int s = 0; s < PIPE_STAGES; s++) {
+        const PipeStageStats *st = &p->stats[s];
+        double stalled = st->total_sec - st->busy_sec;
+        double rate = (st->busy_sec > 0.0)
+                          ? (double)st->records / st->busy_sec / 1e6
+                          : 0.0;
+        printf("%-9s\t%-12llu\t%llu\t%.3f\t%.3f\t\t%.2f\n", stage_names[s],
+               st->records, st->batches, st->busy_sec,
+               stalled > 0.0 ? stalled : 0.0, rate);
+    }
+}
+
+void pipeline_report_stats(const Pipeline *p, Report *r) {
+    for (int s = 0; s < PIPE_STAGES; s++) {
+        const PipeStageStats *st = &p->stats[s];
+        double stalled = st->total_sec - st->busy_sec;
+        report_begin(r, "stage");
+        report_str(r, "stage", stage_names[s]);
+        report_u64(r, "records", st->records);
+        report_u64(r, "batches", st->batches);
+        report_double(r, "busy_sec", st->busy_sec);
+        report_double(r, "stalled_sec", stalled > 0.0 ? stalled : 0.0);
+        report_double(r, "records_per_sec",
+                      st->busy_sec > 0.0 ? (double)st->records / st->busy_sec : 0.0);
+        report_end(r);
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "cachesim.h"
+#include "pagetable.h"
+#include "report.h"
+#include "spsc.h"
+#include "trace.h"
+
+// VM STAGE (Milestone 2): trace records -> translated PhysRecords
+
+// Records one instruction can produce: PHYS_FLUSH_PAGE records for the
+// frames it evicted (with --flush-evicted), then the instruction itself
+#define VM_MAX_RECORDS (VM_MAX_EVICT + 1)
+
+// Records one instruction can produce under vm: page flushes only come
+// with --flush-evicted
+static inline size_t vm_max_records(const VmStats *vm) {
+    return vm->flush_evicted ? VM_MAX_RECORDS : 1;
+}
+
+// Returns the number of records written to out
+size_t vm_translate_record(PageTable *pt, VmStats *vm,
+                           const TraceRecord *rec, PhysRecord *out);
+
+// Translate instructions of one trace into up to max records. Sets *done
+// once the trace is exhausted or the -n limit is reached
+size_t vm_translate_batch(TraceReader *tr, PageTable *pt, VmStats *vm,
+                          int instruction_limit, int *instructions_seen,
+                          int *done, PhysRecord *out, size_t max);
+
+// Scheduled run (--schedule): translate up to *left more instructions of
+// the time slice, counting *left down. Sets *done at the end of the trace
+size_t vm_translate_slice(TraceReader *tr, PageTable *pt, VmStats *vm, int *left,
+                          int *done, PhysRecord *out, size_t max);
+
+// PARSE -> TRANSLATE -> CACHE PIPELINE
+//
+// The parse and translate stages run on their own threads; the cache stage
+// is the caller, pulling PhysBatches with pipeline_next(). Batches travel
+// through SPSC rings and come back through free rings, so at most
+// PIPE_DEPTH batches per stage are in flight. Every ring has a single
+// producer and consumer, so records reach the caches in trace order and
+// the results match the serial loop exactly.
+
+#define PIPE_BATCH 4096          // records per batch
+#define PIPE_DEPTH 16            // batches per stage
+
+typedef struct {
+    TraceRecord recs[PIPE_BATCH];
+    size_t n;
+    int file;                    // trace the records came from
+    int end;                     // no batches follow
+} ParseBatch;
+
+typedef struct {
+    PhysRecord recs[PIPE_BATCH];
+    size_t n;
+    int file;                    // process the records belong to
+    int end;
+} PhysBatch;
+
+enum { PIPE_PARSE, PIPE_TRANSLATE, PIPE_CACHE, PIPE_STAGES };
+
+typedef struct {
+    unsigned long long batches;
+    unsigned long long records;
+    double busy_sec;             // doing the stage's work
+    double total_sec;            // start to end, busy + waiting on rings
+} PipeStageStats;
+
+typedef struct {
+    TraceSet *traces;            // opened and closed by the parse thread
+    PageTable *pt;
+    int instruction_limit;
+    int slice;                   // round-robin slice, 0 = traces one by one
+    VmStats *vm;                 // owned by the translate thread until finish
+
+    ParseBatch *parse_bufs;
+    PhysBatch *phys_bufs;
+    SpscRing parsed, parse_free;         // ParseBatch pointers
+    SpscRing translated, phys_free;      // PhysBatch pointers
+    pthread_t parse_thread, translate_thread;
+
+    double cache_start, cache_mark;
+    PipeStageStats stats[PIPE_STAGES];
+} Pipeline;
+
+void pipeline_start(Pipeline *p, TraceSet *traces, PageTable *pt,
+                    int instruction_limit, int slice, VmStats *vm);
+
+// Cache stage: next translated batch in trace order, NULL after the last.
+// Hand each batch back with pipeline_release() once it is replayed
+const PhysBatch *pipeline_next(Pipeline *p);
+void pipeline_release(Pipeline *p, const PhysBatch *b);
+
+// Join the stage threads; stats and *vm are final afterwards
+void pipeline_finish(Pipeline *p);
+void pipeline_print_stats(const Pipeline *p);
+// The same, one "stage" record per stage (--format=json|csv)
+void pipeline_report_stats(const Pipeline *p, Report *r);
+
+#endif
@@ -0,0 +1,186 @@
+#include "prefetch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PREFETCH_PAGE 4096
+
+int prefetch_config_parse(const char *spec, PrefetchConfig *cfg) {
+    char buf[64];
+    if (strlen(spec) >= sizeof(buf)) return 0;
+    strcpy(buf, spec);
+
+    PrefetchConfig out = {PREFETCH_NONE, 1, 0};
+    int field = 0;
+    for (char *tok = strtok(buf, ":"); tok; tok = strtok(NULL, ":"), field++) {
+        if (field == 0) {
+            if (strcmp(tok, "next") == 0) {
+                out.kind = PREFETCH_NEXT_LINE;
+            } else if (strcmp(tok, "stride") == 0) {
+                out.kind = PREFETCH_STRIDE;
+                out.entries = 64;
+            } else if (strcmp(tok, "stream") == 0) {
+                out.kind = PREFETCH_STREAM;
+                out.entries = 4;
+                out.degree = 4;
+            } else {
+                return 0;
+            }
+            continue;
+        }
+        char *end;
+        long v = strtol(tok, &end, 10);
+        if (*end != '\0' || v < 1 || v > 4096) return 0;
+        if (out.kind == PREFETCH_NEXT_LINE) {
+            if (field > 1) return 0;
+            out.degree = (int)v;
+        } else if (field == 1) {
+            out.entries = (int)v;
+        } else if (field == 2) {
+            out.degree = (int)v;
+        } else {
+            return 0;
+        }
+    }
+    if (field == 0) return 0;
+    *cfg = out;
+    return 1;
+}
+
+const char *prefetch_kind_name(PrefetchKind kind) {
+    switch (kind) {
+    case PREFETCH_NEXT_LINE: return "next-line";
+    case PREFETCH_STRIDE:    return "stride";
+    case PREFETCH_STREAM:    return "stream";
+    default:                 return "none";
+    }
+}
+
+void prefetch_init(Prefetcher *pf, const PrefetchConfig *cfg, CacheSim *cs) {
+    memset(pf, 0, sizeof(*pf));
+    pf->cfg = *cfg;
+    if (cfg->kind == PREFETCH_STRIDE)
+        pf->table = (StrideEntry *)calloc((size_t)cfg->entries, sizeof(StrideEntry));
+    if (cfg->kind == PREFETCH_STREAM)
+        pf->streams = (StreamBuffer *)calloc((size_t)cfg->entries, sizeof(StreamBuffer));
+    if ((cfg->kind == PREFETCH_STRIDE && !pf->table) ||
+        (cfg->kind == PREFETCH_STREAM && !pf->streams)) {
+        fprintf(stderr, "Error: prefetch_init out of memory.\n");
+        exit(1);
+    }
+    cache_sim_prefetcher(cs, pf);
+}
+
+void prefetch_free(Prefetcher *pf) {
+    free(pf->table);
+    free(pf->streams);
+    pf->table = NULL;
+    pf->streams = NULL;
+}
+
+// Fetch block number target if it lies in the same page as block. Returns
+// 0 once the page boundary is crossed, so a run of requests can stop
+static int prefetch_block(Prefetcher *pf, CacheSim *cs, uint32_t block,
+                          long long target) {
+    unsigned long long bs = (unsigned long long)cs->block_size;
+    if (target < 0 ||
+        ((unsigned long long)target * bs) / PREFETCH_PAGE !=
+            ((unsigned long long)block * bs) / PREFETCH_PAGE)
+        return 0;
+    pf->issued++;
+    cache_prefetch(cs, (unsigned long long)target * bs);
+    return 1;
+}
+
+static void prefetch_next_line(Prefetcher *pf, CacheSim *cs, uint32_t block,
+                               PrefetchEvent event) {
+    if (event == PREFETCH_HIT)
+        return;
+    for (int i = 1; i <= pf->cfg.degree; i++) {
+        if (!prefetch_block(pf, cs, block, (long long)block + i))
+            break;
+    }
+}
+
+static void prefetch_stride(Prefetcher *pf, CacheSim *cs, uint32_t block, int fetch) {
+    if (fetch)
+        return;
+    uint32_t pc = cs->pc;
+    StrideEntry *e = &pf->table[pc % (uint32_t)pf->cfg.entries];
+    if (!e->valid || e->pc != pc) {
+        e->valid = 1;
+        e->pc = pc;
+        e->last_block = block;
+        e->stride = 0;
+        e->confidence = 0;
+        return;
+    }
+
+    int32_t stride = (int32_t)(block - e->last_block);
+    e->last_block = block;
+    if (stride == 0)
+        return;   // same block again, e.g. the other word of a record
+    if (stride == e->stride) {
+        if (e->confidence < 3) e->confidence++;
+    } else {
+        if (e->confidence > 0) e->confidence--;
+        if (e->confidence == 0) e->stride = stride;
+        return;
+    }
+    if (e->confidence < 2)
+        return;
+    for (int i = 1; i <= pf->cfg.degree; i++) {
+        if (!prefetch_block(pf, cs, block, (long long)block + (long long)stride * i))
+            break;
+    }
+}
+
+static void prefetch_stream(Prefetcher *pf, CacheSim *cs, uint32_t block,
+                            PrefetchEvent event) {
+    pf->clock++;
+    for (int s = 0; s < pf->cfg.entries; s++) {
+        StreamBuffer *sb = &pf->streams[s];
+        if (sb->dir == 0 || sb->head != block)
+            continue;
+        // head used: advance it and keep depth blocks in flight
+        sb->head += (uint32_t)sb->dir;
+        sb->stamp = pf->clock;
+        long long next = (long long)sb->tail + sb->dir;
+        if (prefetch_block(pf, cs, block, next))
+            sb->tail = (uint32_t)next;
+        return;
+    }
+    if (event != PREFETCH_MISS)
+        return;
+
+    // a new stream: downwards if the previous miss was the block above
+    int32_t dir = (pf->last_miss == block + 1U) ? -1 : 1;
+    pf->last_miss = block;
+    StreamBuffer *sb = &pf->streams[0];
+    for (int s = 1; s < pf->cfg.entries; s++) {
+        if (pf->streams[s].stamp < sb->stamp)
+            sb = &pf->streams[s];
+    }
+    sb->dir = dir;
+    sb->head = block + (uint32_t)dir;
+    sb->tail = block;
+    sb->stamp = pf->clock;
+    for (int i = 1; i <= pf->cfg.degree; i++) {
+        long long next = (long long)block + (long long)dir * i;
+        if (!prefetch_block(pf, cs, block, next))
+            break;
+        sb->tail = (uint32_t)next;
+    }
+}
+
+void prefetch_observe(Prefetcher *pf, CacheSim *cs, unsigned long long block_addr,
+                      PrefetchEvent event, int fetch) {
+    uint32_t block = (uint32_t)(block_addr / (unsigned long long)cs->block_size);
+    switch (pf->cfg.kind) {
+    case PREFETCH_NEXT_LINE: prefetch_next_line(pf, cs, block, event); break;
+    case PREFETCH_STRIDE:    prefetch_stride(pf, cs, block, fetch); break;
+    case PREFETCH_STREAM:    prefetch_stream(pf, cs, block, event); break;
+    default: break;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+
+// HARDWARE PREFETCHERS in front of one CacheSim
+//
+// The cache hands every demand access to the prefetcher, which may answer
+// with cache_prefetch() fills. A prefetched block arrives fill_cycles
+// after it was issued; a demand that finds it still in flight waits for
+// the rest (a late prefetch). Prefetches never leave the 4 KB page of the
+// access that triggered them, as the physical frame after it belongs to
+// someone else.
+//
+//   next    next-N-line, tagged: a miss or the first demand on a
+//           prefetched block fetches the N blocks after it
+//   stride  reference prediction table indexed by the virtual PC (EIP) of
+//           loads and stores; once a PC repeats its stride twice, the next
+//           degree blocks along the stride are fetched
+//   stream  stream buffers: a miss outside every stream allocates one
+//           (LRU) that runs depth blocks ahead of the demand stream, up
+//           or down, and tops up by one block each time its head is used.
+//           The buffers only track the streams: their blocks are filled
+//           into the cache like the other prefetchers' (and can evict
+//           demand blocks), rather than held beside it until first use
+
+typedef enum {
+    PREFETCH_NONE = 0,
+    PREFETCH_NEXT_LINE = 1,
+    PREFETCH_STRIDE = 2,
+    PREFETCH_STREAM = 3
+} PrefetchKind;
+
+typedef struct {
+    PrefetchKind kind;
+    int degree;                  // next: lines; stride: blocks per hit; stream: depth
+    int entries;                 // stride: table entries; stream: buffers
+} PrefetchConfig;
+
+// What the cache saw for one demand access
+typedef enum {
+    PREFETCH_MISS = 0,
+    PREFETCH_HIT = 1,
+    PREFETCH_HIT_PREFETCHED = 2  // first demand on a prefetched block
+} PrefetchEvent;
+
+typedef struct {
+    uint32_t pc;
+    uint32_t last_block;         // block number of the PC's last access
+    int32_t stride;              // in blocks
+    uint8_t valid;
+    uint8_t confidence;          // 2-bit saturating, prefetch at >= 2
+} StrideEntry;
+
+typedef struct {
+    uint32_t head;               // block number expected next
+    uint32_t tail;               // last block fetched
+    int32_t dir;                 // +1 or -1, 0 = free
+    uint32_t stamp;              // LRU
+} StreamBuffer;
+
+typedef struct Prefetcher Prefetcher;
+struct Prefetcher {
+    PrefetchConfig cfg;
+    StrideEntry *table;          // stride: cfg.entries, direct mapped on PC
+    StreamBuffer *streams;       // stream: cfg.entries
+    uint32_t clock;
+    uint32_t last_miss;          // stream: block of the previous miss
+
+    unsigned long long issued;   // requests made, resident blocks included
+};
+
+// "next[:lines]", "stride[:entries[:degree]]" or "stream[:buffers[:depth]]",
+// e.g. "stride:64:2". Returns 1 if OK, 0 if malformed
+int prefetch_config_parse(const char *spec, PrefetchConfig *cfg);
+const char *prefetch_kind_name(PrefetchKind kind);
+
+// Attach a prefetcher to cs; cache_sim_free() detaches it
+void prefetch_init(Prefetcher *pf, const PrefetchConfig *cfg, CacheSim *cs);
+void prefetch_free(Prefetcher *pf);
+
+// Called by the cache kernel after each demand access to block_addr.
+// fetch is set for instruction fetches, whose PC is the block itself
+void prefetch_observe(Prefetcher *pf, CacheSim *cs, unsigned long long block_addr,
+                      PrefetchEvent event, int fetch);
+
+#endif
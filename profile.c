@@ -0,0 +1,106 @@
+#include "profile.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef PROFILE
+
+ProfileStage profile_stages[PROFILE_STAGES];
+__thread uint64_t profile_nested;
+uint64_t profile_overhead;
+
+static const char *profile_names[PROFILE_STAGES] = {
+    "read", "parse", "touch", "translate", "cache", "report"};
+
+static double profile_wall0;
+static uint64_t profile_ticks0;
+
+static double profile_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void profile_start(void) {
+    // a sampled span is only a few dozen ticks, so take the clock's own
+    // cost out of it
+    profile_overhead = ~0ULL;
+    for (int i = 0; i < 256; i++) {
+        uint64_t t0 = profile_ticks();
+        uint64_t d = profile_ticks() - t0;
+        if (d < profile_overhead) profile_overhead = d;
+    }
+    profile_wall0 = profile_now();
+    profile_ticks0 = profile_ticks();
+}
+
+// Run wall time so far, and ticks per second measured over it
+static double profile_elapsed(double *tick_rate) {
+    double wall = profile_now() - profile_wall0;
+    uint64_t ticks = profile_ticks() - profile_ticks0;
+    *tick_rate = (wall > 0.0) ? (double)ticks / wall : 1.0;
+    return wall;
+}
+
+static double profile_sec(const ProfileStage *st, double tick_rate) {
+    return (st->ticks > 0) ? (double)st->ticks / tick_rate : 0.0;
+}
+
+static double profile_per_record(const ProfileStage *st) {
+    return (st->records > 0 && st->ticks > 0) ? (double)st->ticks / (double)st->records
+                                              : 0.0;
+}
+
+void profile_print(void) {
+    double tick_rate;
+    double wall = profile_elapsed(&tick_rate);
+    printf("\n***** SIMULATOR PROFILE *****\n\n");
+    printf("Stage\t\tRecords\t\tBatches\tWall(s)\tMrec/s\t%s\n",
+           PROFILE_TICKS_ARE_CYCLES ? "Cycles/rec" : "ns/rec");
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        const ProfileStage *st = &profile_stages[s];
+        double sec = profile_sec(st, tick_rate);
+        double rate = (sec > 0.0) ? (double)st->records / sec / 1e6 : 0.0;
+        printf("%-9s\t%-12llu\t%llu\t%.3f\t%.2f\t%.1f\n", profile_names[s],
+               st->records, st->batches, sec, rate, profile_per_record(st));
+    }
+    printf("%-9s\t\t\t\t%.3f\n", "total", wall);
+    printf("(read counts bytes; touch is sampled 1 in %d, its batches are the "
+           "samples)\n", PROFILE_SAMPLE);
+}
+
+void profile_report(Report *r) {
+    double tick_rate;
+    double wall = profile_elapsed(&tick_rate);
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        const ProfileStage *st = &profile_stages[s];
+        double sec = profile_sec(st, tick_rate);
+        report_begin(r, "profile");
+        report_str(r, "stage", profile_names[s]);
+        report_u64(r, "records", st->records);
+        report_u64(r, "batches", st->batches);
+        report_double(r, "wall_sec", sec);
+        report_double(r, "records_per_sec", (sec > 0.0) ? (double)st->records / sec : 0.0);
+        report_double(r, PROFILE_TICKS_ARE_CYCLES ? "cycles_per_record" : "ns_per_record",
+                      profile_per_record(st));
+        report_end(r);
+    }
+    report_begin(r, "profile");
+    report_str(r, "stage", "total");
+    report_u64(r, "records", 0);
+    report_u64(r, "batches", 0);
+    report_double(r, "wall_sec", wall);
+    report_double(r, "records_per_sec", 0.0);
+    report_double(r, PROFILE_TICKS_ARE_CYCLES ? "cycles_per_record" : "ns_per_record", 0.0);
+    report_end(r);
+}
+
+#else
+
+void profile_start(void) {}
+void profile_print(void) {}
+void profile_report(Report *r) {
+    (void)r;
+}
+
+#endif
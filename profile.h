@@ -0,0 +1,113 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#include "report.h"
+
+// SELF-PROFILING (--profile, built with 'make PROFILE=1')
+//
+// Where the simulator's own time goes: wall time, records/s and cycles
+// per record of each stage. The clock is read around batches, never
+// around a single call:
+//
+//   read       trace_open and the buffered backend's block reads (its
+//              records are bytes); a mapped trace pages in during parse
+//   parse      a chunk of trace lines into TraceRecords
+//   touch      page-table and TLB touches of an instruction, timed on one
+//              instruction in PROFILE_SAMPLE and scaled up
+//   translate  the rest of the VM stage: PhysRecords for a chunk
+//   cache      a batch through every cache (and --mrc)
+//   report     printing the results
+//
+// A stage timed inside another (read inside parse, touch inside
+// translate) is taken out of the outer one. Without PROFILE every macro
+// below compiles to nothing.
+
+enum {
+    PROFILE_READ,
+    PROFILE_PARSE,
+    PROFILE_TOUCH,
+    PROFILE_TRANSLATE,
+    PROFILE_CACHE,
+    PROFILE_REPORT,
+    PROFILE_STAGES
+};
+
+#define PROFILE_SAMPLE 64        // power of two
+
+#ifdef PROFILE
+
+typedef struct {
+    int64_t ticks;               // own time, nested stages taken out
+    unsigned long long records;
+    unsigned long long batches;
+} ProfileStage;
+
+extern ProfileStage profile_stages[PROFILE_STAGES];
+extern __thread uint64_t profile_nested;    // ticks of spans ended so far
+extern uint64_t profile_overhead;           // ticks of reading the clock
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_TICKS_ARE_CYCLES 1
+static inline uint64_t profile_ticks(void) {
+    return __rdtsc();
+}
+#else
+#include <time.h>
+#define PROFILE_TICKS_ARE_CYCLES 0
+static inline uint64_t profile_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+// One span of a stage over n records
+static inline void profile_end(int stage, uint64_t t0, uint64_t nested0,
+                               unsigned long long n) {
+    uint64_t d = profile_ticks() - t0;
+    ProfileStage *st = &profile_stages[stage];
+    st->ticks += (int64_t)(d - (profile_nested - nested0));
+    st->records += n;
+    st->batches++;
+    profile_nested = nested0 + d;
+}
+
+// A sampled span stands for PROFILE_SAMPLE records (batches counts samples)
+static inline void profile_sample_end(int stage, uint64_t t0) {
+    uint64_t d = profile_ticks() - t0;
+    d = (d > profile_overhead) ? (d - profile_overhead) * PROFILE_SAMPLE : 0;
+    profile_stages[stage].ticks += (int64_t)d;
+    profile_stages[stage].batches++;
+    profile_nested += d;
+}
+
+#define PROFILE_BEGIN(t) \
+    uint64_t t = profile_ticks(), t##_nested = profile_nested
+#define PROFILE_END(stage, t, n) profile_end((stage), t, t##_nested, (n))
+
+// Count a record of a sampled stage, timing one in PROFILE_SAMPLE
+#define PROFILE_SAMPLE_BEGIN(stage, t)                                   \
+    uint64_t t = ((++profile_stages[stage].records & (PROFILE_SAMPLE - 1)) == 0) \
+                     ? profile_ticks() : 0
+#define PROFILE_SAMPLE_END(stage, t) \
+    do { if (t) profile_sample_end((stage), t); } while (0)
+
+#else
+
+#define PROFILE_BEGIN(t) ((void)0)
+#define PROFILE_END(stage, t, n) ((void)0)
+#define PROFILE_SAMPLE_BEGIN(stage, t) ((void)0)
+#define PROFILE_SAMPLE_END(stage, t) ((void)0)
+
+#endif
+
+// Start the run's wall clock; the tick rate is measured against it
+void profile_start(void);
+// Stage table, or one "profile" record per stage (--format=json|csv)
+void profile_print(void);
+void profile_report(Report *r);
+
+#endif
@@ -0,0 +1,183 @@
+#include "report.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+int output_format_parse(const char *opt, OutputFormat *format) {
+    if (strcmp(opt, "text") == 0) *format = FORMAT_TEXT;
+    else if (strcmp(opt, "json") == 0) *format = FORMAT_JSON;
+    else if (strcmp(opt, "csv") == 0) *format = FORMAT_CSV;
+    else return 0;
+    return 1;
+}
+
+// GROWABLE LINE BUFFERS
+
+static void buf_reserve(ReportBuf *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap)
+        return;
+    size_t cap = b->cap ? b->cap : 256;
+    while (cap < b->len + extra + 1)
+        cap *= 2;
+    char *tmp = (char *)realloc(b->data, cap);
+    if (!tmp) {
+        fprintf(stderr, "Error: report out of memory.\n");
+        exit(1);
+    }
+    b->data = tmp;
+    b->cap = cap;
+}
+
+static void buf_printf(ReportBuf *b, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    buf_reserve(b, (size_t)n);
+    va_start(ap, fmt);
+    vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    b->len += (size_t)n;
+}
+
+static void buf_putc(ReportBuf *b, char c) {
+    buf_reserve(b, 1);
+    b->data[b->len++] = c;
+    b->data[b->len] = '\0';
+}
+
+// A JSON string, or a CSV field quoted when it holds , " or a line break
+static void buf_quoted(ReportBuf *b, OutputFormat format, const char *s) {
+    if (format == FORMAT_CSV) {
+        if (!strpbrk(s, ",\"\r\n")) {
+            buf_printf(b, "%s", s);
+            return;
+        }
+        buf_putc(b, '"');
+        for (; *s; s++) {
+            if (*s == '"') buf_putc(b, '"');
+            buf_putc(b, *s);
+        }
+        buf_putc(b, '"');
+        return;
+    }
+    buf_putc(b, '"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            buf_putc(b, '\\');
+            buf_putc(b, (char)c);
+        } else if (c < 0x20) {
+            buf_printf(b, "\\u%04x", c);
+        } else {
+            buf_putc(b, (char)c);
+        }
+    }
+    buf_putc(b, '"');
+}
+
+// RECORDS
+
+void report_init(Report *r, OutputFormat format, FILE *out) {
+    memset(r, 0, sizeof(*r));
+    r->format = format;
+    r->out = out;
+}
+
+void report_free(Report *r) {
+    free(r->keys.data);
+    free(r->values.data);
+    free(r->header.data);
+    memset(r, 0, sizeof(*r));
+}
+
+// Start the next field: separator, then the key
+static void report_key(Report *r, const char *key) {
+    if (r->format == FORMAT_CSV) {
+        if (r->fields > 0) {
+            buf_putc(&r->keys, ',');
+            buf_putc(&r->values, ',');
+        }
+        buf_quoted(&r->keys, r->format, key);
+    } else {
+        if (r->fields > 0) buf_putc(&r->values, ',');
+        buf_quoted(&r->values, r->format, key);
+        buf_putc(&r->values, ':');
+    }
+    r->fields++;
+}
+
+void report_begin(Report *r, const char *kind) {
+    r->fields = 0;
+    r->keys.len = 0;
+    r->values.len = 0;
+    if (r->format == FORMAT_JSON)
+        buf_putc(&r->values, '{');
+    report_str(r, "record", kind);
+}
+
+void report_str(Report *r, const char *key, const char *value) {
+    report_key(r, key);
+    buf_quoted(&r->values, r->format, value ? value : "");
+}
+
+void report_int(Report *r, const char *key, long long value) {
+    report_key(r, key);
+    buf_printf(&r->values, "%lld", value);
+}
+
+void report_u64(Report *r, const char *key, unsigned long long value) {
+    report_key(r, key);
+    buf_printf(&r->values, "%llu", value);
+}
+
+void report_double(Report *r, const char *key, double value) {
+    report_key(r, key);
+    if (!isfinite(value)) {
+        if (r->format == FORMAT_JSON) buf_printf(&r->values, "null");
+        return;
+    }
+    buf_printf(&r->values, "%.10g", value);
+}
+
+void report_list(Report *r, const char *key, char **values, int count) {
+    report_key(r, key);
+    if (r->format == FORMAT_JSON) {
+        buf_putc(&r->values, '[');
+        for (int i = 0; i < count; i++) {
+            if (i > 0) buf_putc(&r->values, ',');
+            buf_quoted(&r->values, r->format, values[i]);
+        }
+        buf_putc(&r->values, ']');
+        return;
+    }
+    ReportBuf joined = {NULL, 0, 0};
+    buf_reserve(&joined, 0);
+    joined.data[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        if (i > 0) buf_putc(&joined, ';');
+        buf_printf(&joined, "%s", values[i]);
+    }
+    buf_quoted(&r->values, r->format, joined.data);
+    free(joined.data);
+}
+
+void report_end(Report *r) {
+    if (r->format == FORMAT_CSV) {
+        buf_reserve(&r->keys, 0);
+        buf_reserve(&r->header, 0);
+        if (r->header.len != r->keys.len ||
+            memcmp(r->header.data, r->keys.data, r->keys.len) != 0) {
+            fprintf(r->out, "%s\n", r->keys.data);
+            r->header.len = 0;
+            buf_printf(&r->header, "%s", r->keys.data);
+        }
+    } else {
+        buf_putc(&r->values, '}');
+    }
+    buf_reserve(&r->values, 0);
+    fprintf(r->out, "%s\n", r->values.data);
+    fflush(r->out);
+}
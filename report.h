@@ -0,0 +1,57 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// MACHINE-READABLE RESULTS (--format=json|csv)
+//
+// A record is a flat list of key/value fields, written out as one line as
+// soon as it ends and flushed, so a harness can consume a sweep while it
+// is still running.
+//
+//   json  one object per line (JSON lines)
+//   csv   a header line, then one row per record; the header is repeated
+//         whenever a record's fields differ from the previous one (the
+//         record kinds of one run come in blocks)
+//
+// Every record starts with a "record" field naming its kind.
+
+typedef enum {
+    FORMAT_TEXT = 0,             // the human-readable report
+    FORMAT_JSON = 1,
+    FORMAT_CSV = 2
+} OutputFormat;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} ReportBuf;
+
+typedef struct {
+    OutputFormat format;
+    FILE *out;
+    int fields;                  // fields in the open record
+    ReportBuf keys;              // csv: this record's header
+    ReportBuf values;            // the record's line
+    ReportBuf header;            // csv: header printed last
+} Report;
+
+// Parse a --format value. Returns 1 if OK, 0 if unknown
+int output_format_parse(const char *opt, OutputFormat *format);
+
+void report_init(Report *r, OutputFormat format, FILE *out);
+void report_free(Report *r);
+
+void report_begin(Report *r, const char *kind);
+void report_str(Report *r, const char *key, const char *value);
+void report_int(Report *r, const char *key, long long value);
+void report_u64(Report *r, const char *key, unsigned long long value);
+void report_double(Report *r, const char *key, double value);
+// A list of strings: a JSON array, or one CSV field joined with ';'
+void report_list(Report *r, const char *key, char **values, int count);
+// Write the record out and flush it
+void report_end(Report *r);
+
+#endif
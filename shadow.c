@@ -0,0 +1,122 @@
+#include "shadow.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *shadow_alloc(size_t n, size_t size) {
+    void *p = calloc(n, size);
+    if (!p) {
+        fprintf(stderr, "Error: shadow cache out of memory.\n");
+        exit(1);
+    }
+    return p;
+}
+
+void shadow_init(ShadowCache *sc, unsigned long long capacity) {
+    memset(sc, 0, sizeof(*sc));
+    sc->capacity = capacity;
+    sc->nodes_cap = 1024;
+    sc->nodes = (ShadowNode *)shadow_alloc(sc->nodes_cap, sizeof(ShadowNode));
+    sc->table_cap = 2048;
+    sc->table = (uint32_t *)shadow_alloc(sc->table_cap, sizeof(uint32_t));
+    sc->mru = sc->lru = SHADOW_NIL;
+}
+
+void shadow_free(ShadowCache *sc) {
+    free(sc->nodes);
+    free(sc->table);
+    memset(sc, 0, sizeof(*sc));
+}
+
+// BLOCK -> NODE TABLE
+
+static size_t shadow_slot(const ShadowCache *sc, unsigned long long block) {
+    size_t mask = sc->table_cap - 1;
+    size_t i = (size_t)((block * 0x9E3779B97F4A7C15ULL) >> 20) & mask;
+    while (sc->table[i] != 0 && sc->nodes[sc->table[i] - 1].block != block)
+        i = (i + 1) & mask;
+    return i;
+}
+
+static void shadow_grow_table(ShadowCache *sc) {
+    free(sc->table);
+    sc->table_cap *= 2;
+    sc->table = (uint32_t *)shadow_alloc(sc->table_cap, sizeof(uint32_t));
+    for (size_t n = 0; n < sc->num_nodes; n++)
+        sc->table[shadow_slot(sc, sc->nodes[n].block)] = (uint32_t)n + 1;
+}
+
+// LRU LIST
+
+static void shadow_unlink(ShadowCache *sc, uint32_t n) {
+    ShadowNode *node = &sc->nodes[n];
+    if (node->prev != SHADOW_NIL) sc->nodes[node->prev].next = node->next;
+    else sc->mru = node->next;
+    if (node->next != SHADOW_NIL) sc->nodes[node->next].prev = node->prev;
+    else sc->lru = node->prev;
+    node->resident = 0;
+    sc->resident--;
+}
+
+static void shadow_push_mru(ShadowCache *sc, uint32_t n) {
+    ShadowNode *node = &sc->nodes[n];
+    node->prev = SHADOW_NIL;
+    node->next = sc->mru;
+    if (sc->mru != SHADOW_NIL) sc->nodes[sc->mru].prev = n;
+    else sc->lru = n;
+    sc->mru = n;
+    node->resident = 1;
+    sc->resident++;
+}
+
+ShadowResult shadow_access(ShadowCache *sc, unsigned long long block) {
+    size_t slot = shadow_slot(sc, block);
+    uint32_t n;
+    ShadowResult result;
+    if (sc->table[slot] != 0) {
+        n = sc->table[slot] - 1;
+        if (sc->nodes[n].resident) {
+            if (sc->mru != n) {
+                shadow_unlink(sc, n);
+                shadow_push_mru(sc, n);
+            }
+            return SHADOW_HIT;
+        }
+        result = SHADOW_MISS;
+    } else {
+        if (sc->num_nodes == sc->nodes_cap) {
+            size_t cap = sc->nodes_cap * 2;
+            ShadowNode *tmp = (ShadowNode *)realloc(sc->nodes, cap * sizeof(ShadowNode));
+            if (!tmp) {
+                fprintf(stderr, "Error: shadow cache out of memory.\n");
+                exit(1);
+            }
+            sc->nodes = tmp;
+            sc->nodes_cap = cap;
+        }
+        n = (uint32_t)sc->num_nodes++;
+        sc->nodes[n].block = block;
+        sc->nodes[n].resident = 0;
+        sc->table[slot] = n + 1;
+        if (2 * sc->num_nodes > sc->table_cap)
+            shadow_grow_table(sc);
+        result = SHADOW_COLD;
+    }
+
+    if (sc->resident == sc->capacity)
+        shadow_unlink(sc, sc->lru);
+    shadow_push_mru(sc, n);
+    return result;
+}
+
+void shadow_invalidate(ShadowCache *sc, unsigned long long block) {
+    uint32_t idx = sc->table[shadow_slot(sc, block)];
+    if (idx != 0 && sc->nodes[idx - 1].resident)
+        shadow_unlink(sc, idx - 1);
+}
+
+void shadow_flush(ShadowCache *sc) {
+    while (sc->mru != SHADOW_NIL)
+        shadow_unlink(sc, sc->mru);
+}
@@ -0,0 +1,63 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 3C MISS CLASSIFICATION
+//
+// A fully associative LRU cache with as many blocks as the real one sees
+// the same demand stream (and the prefetcher's fills, which take room in
+// both). A miss in the real cache is
+//
+//   compulsory  the block was never referenced before
+//   capacity    the shadow missed too: no placement of this many blocks
+//               would have kept it
+//   conflict    the shadow hit: only the set mapping lost it
+//
+// Every block ever seen keeps a node (so cold misses are exact); resident
+// ones are linked MRU to LRU. Lookup is an open-addressed hash on the
+// block number, so an access costs O(1) whatever the capacity.
+
+#define SHADOW_NIL UINT32_MAX
+
+typedef enum {
+    SHADOW_HIT = 0,
+    SHADOW_MISS = 1,
+    SHADOW_COLD = 2              // first reference to the block
+} ShadowResult;
+
+typedef struct {
+    unsigned long long block;
+    uint32_t prev;               // towards MRU, SHADOW_NIL at the ends
+    uint32_t next;               // towards LRU
+    uint8_t resident;
+} ShadowNode;
+
+typedef struct ShadowCache ShadowCache;
+struct ShadowCache {
+    unsigned long long capacity; // blocks, the real cache's num_blocks
+    unsigned long long resident;
+
+    ShadowNode *nodes;           // one per block ever seen
+    size_t num_nodes;
+    size_t nodes_cap;
+
+    uint32_t *table;             // node index + 1, 0 = empty
+    size_t table_cap;            // power of two, kept under half full
+
+    uint32_t mru;
+    uint32_t lru;
+};
+
+void shadow_init(ShadowCache *sc, unsigned long long capacity);
+void shadow_free(ShadowCache *sc);
+
+// Reference block (a block number); the result is the shadow's view
+ShadowResult shadow_access(ShadowCache *sc, unsigned long long block);
+// The block left the real cache without a reference (page flush)
+void shadow_invalidate(ShadowCache *sc, unsigned long long block);
+// Empty the shadow (context switch flush); blocks stay known, not cold
+void shadow_flush(ShadowCache *sc);
+
+#endif
@@ -0,0 +1,98 @@
+#include "shard.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *shard_main(void *arg) {
+    CacheShard *sh = (CacheShard *)arg;
+    uint64_t blocks[SHARD_STAGE];
+
+    for (;;) {
+        // done is set after the last push: once it is seen, drain what is
+        // left and stop at the first empty pop
+        int done = atomic_load_explicit(&sh->done, memory_order_acquire);
+        size_t n = spsc_pop(&sh->ring, blocks, SHARD_STAGE);
+        if (n == 0) {
+            if (done)
+                break;
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; i++)
+            cache_access_block(&sh->cs, blocks[i]);
+    }
+    return NULL;
+}
+
+static void shard_flush(CacheShard *sh) {
+    spsc_push_all(&sh->ring, sh->stage, (size_t)sh->staged);
+    sh->staged = 0;
+}
+
+// CacheBlockSink: route one block to the shard owning its set
+static void shard_route(void *ctx, unsigned long long block_addr) {
+    ShardedCache *sc = (ShardedCache *)ctx;
+    const CacheSim *cs = sc->cs;
+    unsigned long long block_num =
+        (block_addr & CACHE_ADDR_MASK) / (unsigned long long)cs->block_size;
+    unsigned long long set_index = block_num % (unsigned long long)cs->num_sets;
+    CacheShard *sh = &sc->shards[set_index >> sc->shard_shift];
+
+    sh->stage[sh->staged++] = block_addr;
+    if (sh->staged == SHARD_STAGE)
+        shard_flush(sh);
+}
+
+void shard_cache_start(ShardedCache *sc, CacheSim *cs, int threads) {
+    int shards = 1;
+    while (shards * 2 <= threads && shards * 2 <= cs->num_sets)
+        shards *= 2;
+    int shard_bits = 0;
+    while ((1 << shard_bits) < shards) shard_bits++;
+
+    sc->cs = cs;
+    sc->num_shards = shards;
+    sc->shard_shift = cs->index_bits - shard_bits;
+    sc->shards = (CacheShard *)calloc((size_t)shards, sizeof(CacheShard));
+    if (!sc->shards) {
+        fprintf(stderr, "Error: shard_cache_start out of memory.\n");
+        exit(1);
+    }
+
+    for (int s = 0; s < shards; s++) {
+        CacheShard *sh = &sc->shards[s];
+        sh->cs = *cs;
+        sh->cs.accesses = sh->cs.hits = sh->cs.misses = 0;
+        sh->cs.compulsory_misses = sh->cs.conflict_misses = 0;
+        sh->cs.writebacks = sh->cs.memory_writes = 0;
+        sh->cs.total_cycles = 0;
+        cache_sim_seed(&sh->cs, cs->rng_state + (unsigned long long)s);
+        spsc_init(&sh->ring, SHARD_RING, sizeof(uint64_t));
+        atomic_init(&sh->done, 0);
+        if (pthread_create(&sh->thread, NULL, shard_main, sh) != 0) {
+            fprintf(stderr, "Error: cannot create cache shard thread.\n");
+            exit(1);
+        }
+    }
+}
+
+void shard_cache_replay(ShardedCache *sc, const PhysRecord *recs, size_t n) {
+    cache_sim_replay_to(sc->cs, recs, n, shard_route, sc);
+}
+
+void shard_cache_finish(ShardedCache *sc) {
+    for (int s = 0; s < sc->num_shards; s++) {
+        shard_flush(&sc->shards[s]);
+        atomic_store_explicit(&sc->shards[s].done, 1, memory_order_release);
+    }
+    for (int s = 0; s < sc->num_shards; s++) {
+        CacheShard *sh = &sc->shards[s];
+        pthread_join(sh->thread, NULL);
+        cache_sim_merge(sc->cs, &sh->cs);
+        spsc_free(&sh->ring);
+    }
+    free(sc->shards);
+    sc->shards = NULL;
+}
@@ -0,0 +1,49 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "cachesim.h"
+#include "spsc.h"
+
+// SET-PARTITIONED SIMULATION OF ONE CACHE
+//
+// Sets are independent, so the set index space is cut into contiguous
+// ranges, one per thread. The producer does the instruction bookkeeping
+// and routes every block address to its shard's SPSC ring. Each shard runs
+// cache_access_block() on its own CacheSim view of the shared tag arrays,
+// so every set still sees its accesses in trace order. Policies with only
+// per-set state (RR, LRU, PLRU, NRU, SRRIP) give counters bit-identical to
+// the serial run. RND and BRRIP draw from one generator per shard and
+// DRRIP keeps one psel per shard, so they are reproducible but differ
+// from serial.
+
+#define SHARD_RING 65536         // block addresses per shard ring
+#define SHARD_STAGE 256          // addresses staged before a push
+
+typedef struct {
+    CacheSim cs;                 // shares tags and sets, own counters
+    SpscRing ring;
+    atomic_int done;             // producer finished, drain and exit
+    pthread_t thread;
+
+    uint64_t stage[SHARD_STAGE]; // producer-side staging, CACHE_* flags kept
+    int staged;
+} CacheShard;
+
+typedef struct {
+    CacheSim *cs;                // the cache being simulated
+    CacheShard *shards;
+    int num_shards;
+    int shard_shift;             // set index >> shard_shift = shard
+} ShardedCache;
+
+// Split cs across up to threads shards (a power of two <= num_sets)
+void shard_cache_start(ShardedCache *sc, CacheSim *cs, int threads);
+void shard_cache_replay(ShardedCache *sc, const PhysRecord *recs, size_t n);
+// Drain the shards, join them and merge their counters into cs
+void shard_cache_finish(ShardedCache *sc);
+
+#endif
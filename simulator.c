@@ -6,394 +6,939 @@
 #include <string.h>
 #include <time.h>
 
-#define FILE_NUM 3              // Accept 1 to 3 trace files
-#define PAGE_SIZE 4096
-#define VA_PAGES_PER_PROC (512ULL * 1024ULL)
-
-// PAGE TABLE STRUCTS (Milestone 2)
+#include "cachesim.h"
+#include "hierarchy.h"
+#include "interval.h"
+#include "prefetch.h"
+#include "report.h"
+#include "shadow.h"
+#include "pagetable.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "shard.h"
+#include "stackdist.h"
+#include "tlb.h"
+#include "victim.h"
+#include "sweep.h"
+#include "trace.h"
+
+#define SWEEP_MAX 32            // max values per -s/-b/-a/-r list
+#define PHYS_BATCH 4096         // instructions translated per batch
+
+// CACHE CALCULATED VALUES (Milestone 1)
 
 typedef struct {
-    unsigned long long vpn;    // virtual page number
-    unsigned long long ppn;    // physical page number
-} MapEntry;
+    int num_blocks;
+    int num_rows;
+    int index_bits;
+    int offset_bits;
+    int tag_size;
+    int total_overhead;
+    int implementation_memory;
+    double implementation_memory_kb;
+    double cost;
+} CacheCalc;
+
+static void cache_calc(CacheCalc *cc, int cache_size, int block_size,
+                       int associativity, int physical_mem) {
+    cc->num_blocks = (cache_size * 1024) / block_size;
+    cc->num_rows = cc->num_blocks / associativity;
+    cc->index_bits = (int)log2(cc->num_rows);
+    cc->offset_bits = (int)log2(block_size);
+    double phys_mem_bits = log2(pow(2.0, 20.0) * (double)physical_mem);
+    cc->tag_size = (int)(phys_mem_bits - cc->offset_bits - cc->index_bits);
 
-typedef struct {
-    MapEntry* arr;             // array of entries
-    size_t used;               // number of valid entries
-    size_t cap;                // capacity of the array
-} PageTable;
-
-// Initialize page table
-static void pt_init(PageTable* pt) {
-    pt->arr = NULL;
-    pt->used = 0;
-    pt->cap = 0;
-}
+    int overhead_per_row_bits = associativity * (cc->tag_size + 1); /* tag + valid */
+    cc->total_overhead =
+        (int)ceil((double)cc->num_rows * (double)overhead_per_row_bits / 8.0);
 
-// Free page table memory
-static void pt_free(PageTable* pt) {
-    free(pt->arr);
-    pt->arr = NULL;
-    pt->used = 0;
-    pt->cap = 0;
+    cc->implementation_memory = (cache_size * 1024) + cc->total_overhead;
+    cc->implementation_memory_kb = cc->implementation_memory / 1024.0;
+    cc->cost = cc->implementation_memory_kb * 0.07;
 }
 
-// Linear search for VPN in page table
-static long pt_find(PageTable* pt, unsigned long long vpn) {
-    for (size_t i = 0; i < pt->used; i++) {
-        if (pt->arr[i].vpn == vpn)
-            return (long)i;
+// COMMAND LINE LISTS (sweep mode)
+
+// Parse "8", "8,16,64" or a power-of-two range "8-8192" into out[].
+// Returns the number of values, or -1 if the list is malformed
+static int parse_int_list(const char *arg, int *out, int max) {
+    int n = 0;
+    const char *p = arg;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        if (end == p) return -1;
+        long hi = lo;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo || lo < 1) return -1;
+        }
+        for (long v = lo; v <= hi; v *= 2) {
+            if (n == max) return -1;
+            out[n++] = (int)v;
+        }
+        if (*end == ',') end++;
+        else if (*end != '\0') return -1;
+        p = end;
     }
-    return -1; // not found
+    return n;
 }
 
-// Add a new mapping to the page table
-static void pt_push(PageTable* pt, unsigned long long vpn, unsigned long long ppn) {
-    if (pt->used == pt->cap) {
-        size_t new_cap = (pt->cap == 0) ? 1 : pt->cap * 2;
-        MapEntry* tmp = (MapEntry*)realloc(pt->arr, new_cap * sizeof(MapEntry));
-        if (!tmp) {
-            fprintf(stderr, "Error: Memory allocation failed in pt_push.\n");
-            exit(1);
-        }
-        pt->arr = tmp;
-        pt->cap = new_cap;
+// 1 if the list has values and all of them lie in [lo, hi]
+static int list_in_range(const int *v, int n, int lo, int hi) {
+    if (n < 1) return 0;
+    for (int i = 0; i < n; i++) {
+        if (v[i] < lo || v[i] > hi) return 0;
     }
-    pt->arr[pt->used].vpn = vpn;
-    pt->arr[pt->used].ppn = ppn;
-    pt->used++;
+    return 1;
 }
 
-/* Touch one virtual page: update stats + maybe map from free */
-static void vm_touch_page(PageTable* pt,
-                          unsigned long long vpn,
-                          unsigned long long* page_table_hits,
-                          unsigned long long* pages_from_free,
-                          unsigned long long* total_page_faults,
-                          unsigned long long* virtual_pages_mapped,
-                          unsigned long long* free_ppn_left,
-                          unsigned long long* next_ppn) {
-    long idx = pt_find(pt, vpn);
-    if (idx >= 0) {
-        (*page_table_hits)++;
-    } else {
-        if (*free_ppn_left > 0) {
-            pt_push(pt, vpn, *next_ppn);
-            (*next_ppn)++;
-            (*free_ppn_left)--;
-            (*pages_from_free)++;
-        } else {
-            (*total_page_faults)++;
-        }
+// Parse "rr" or "rr,rnd" into out[]. Returns count, -1 on a bad name
+static int parse_policy_list(const char *arg, ReplacementPolicy *out, int max) {
+    char buf[256];
+    int n = 0;
+    strncpy(buf, arg, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        if (n == max || !cache_policy_parse(tok, &out[n])) return -1;
+        n++;
     }
-    (*virtual_pages_mapped)++;
+    return n;
 }
 
-// Translate VA -> PA if mapped. Return 1 if OK, 0 if unmapped 
-static int vm_translate(PageTable* pt,
-                        unsigned long long vaddr,
-                        unsigned long long* paddr_out) {
-    unsigned long long vpn = vaddr >> 12;
-    unsigned long long offset = vaddr & (PAGE_SIZE - 1);
-    long idx = pt_find(pt, vpn);
-    if (idx < 0) return 0;
-    unsigned long long ppn = pt->arr[idx].ppn;
-    *paddr_out = (ppn << 12) | offset;
-    return 1;
+// CACHE STAGE: hand translated records to the caches, inline, on the
+// sweep worker pool or split by sets across shard threads
+
+// Per-process share of the first configuration under --schedule
+typedef struct {
+    unsigned long long instructions;
+    unsigned long long cycles;   // cache stage, switch cost and flushes
+    unsigned long long switches_in;
+} ProcStats;
+
+typedef struct {
+    CacheSim *caches;
+    int num_caches;
+    StackDist *sd;               // --mrc, else NULL
+    SweepPool *pool;             // sweeping on workers, else NULL
+    SweepChunk *chunk;           // pool chunk being filled
+    ShardedCache *sharded;       // one cache split by sets, else NULL
+    Hierarchy *hier;             // --l2: L1I/L1D/L2[/L3] instead of caches
+    IntervalSampler *sampler;    // --interval, else NULL
+
+    // --schedule (inline caches only): context switches and who ran
+    ProcStats *procs;            // NULL unless scheduling
+    int running;                 // process of the last records, -1 at start
+    unsigned long long switches;
+    int switch_cost;
+    int flush_on_switch;
+} CacheStage;
+
+static unsigned long long *stage_cycles(CacheStage *st) {
+    return st->hier ? &st->hier->total_cycles : &st->caches[0].total_cycles;
 }
 
-// TRACE PARSING HELPERS 
-
-// Parse EIP line
-int parse_eip_line(const char* line, unsigned long long* addr, int* len) {
-    if (strncmp(line, "EIP", 3) != 0) return 0;
-    
-    char len_str[3] = { line[5], line[6], '\0' };
-    *len = atoi(len_str);
-    
-    char addr_str[9];
-    strncpy(addr_str, line + 10, 8);
-    addr_str[8] = '\0';
-    
-    unsigned long long val = strtoull(addr_str, NULL, 16);
-    if (val > 0x7FFFFFFF) return 0;
-    *addr = val;
-    
-    return 1;
+static unsigned long long stage_instructions(const CacheStage *st) {
+    return st->hier ? st->hier->total_instructions : st->caches[0].total_instructions;
 }
 
-// Parse dst/src memory line
-int parse_dst_src_line(const char* line,
-                       unsigned long long* dst_addr, int* dst_valid,
-                       unsigned long long* src_addr, int* src_valid) {
-    const char* p;
-    *dst_addr = *src_addr = 0;
-    *dst_valid = *src_valid = 0;
-
-    // dstM
-    p = strstr(line, "dstM:");
-    if (p) {
-        p += 5;
-        while (*p == ' ' || *p == '\t') p++;
-        const char* src_start = strstr(p, "srcM:");
-        int len = src_start ? (int)(src_start - p) : (int)strlen(p);
-        char buf[64];
-        if (len >= (int)sizeof(buf)) len = (int)sizeof(buf) - 1;
-        strncpy(buf, p, len);
-        buf[len] = '\0';
-
-        if (!strstr(buf, "--------")) {
-            unsigned long long val = strtoull(buf, NULL, 16);
-            if (val <= 0x7FFFFFFF) {
-                *dst_addr = val;
-                *dst_valid = 1;
-            }
+// A different process got the CPU: charge the switch and flush if asked
+static void cache_stage_switch(CacheStage *st, int proc) {
+    if (st->running >= 0) {
+        st->switches++;
+        st->procs[proc].switches_in++;
+        for (int c = 0; c < st->num_caches; c++) {
+            st->caches[c].total_cycles += (unsigned long long)st->switch_cost;
+            if (st->flush_on_switch)
+                cache_sim_flush(&st->caches[c]);
+        }
+        if (st->hier) {
+            st->hier->total_cycles += (unsigned long long)st->switch_cost;
+            if (st->flush_on_switch)
+                hier_flush(st->hier);
         }
     }
+    st->running = proc;
+}
+
+static void cache_stage_run(CacheStage *st, const PhysRecord *recs, size_t n,
+                            int proc) {
+    unsigned long long cycles0 = 0, instructions0 = 0;
+    if (st->procs && n > 0) {
+        cycles0 = *stage_cycles(st);
+        instructions0 = stage_instructions(st);
+        if (proc != st->running)
+            cache_stage_switch(st, proc);
+    }
+
+    if (st->sd)
+        stackdist_replay(st->sd, recs, n);
 
-    // srcM
-    p = strstr(line, "srcM:");
-    if (p) {
-        p += 5;
-        while (*p == ' ' || *p == '\t') p++;
-        char buf[64];
-        strncpy(buf, p, sizeof(buf)-1);
-        buf[sizeof(buf)-1] = '\0';
-
-        if (!strstr(buf, "--------")) {
-            unsigned long long val = strtoull(buf, NULL, 16);
-            if (val <= 0x7FFFFFFF) {
-                *src_addr = val;
-                *src_valid = 1;
+    if (st->pool) {
+        // batch records up into full chunks before waking the workers
+        while (n > 0) {
+            if (!st->chunk) {
+                st->chunk = sweep_pool_chunk(st->pool);
+                st->chunk->n = 0;
+            }
+            size_t take = SWEEP_CHUNK - st->chunk->n;
+            if (take > n) take = n;
+            memcpy(st->chunk->recs + st->chunk->n, recs, take * sizeof(PhysRecord));
+            st->chunk->n += take;
+            recs += take;
+            n -= take;
+            if (st->chunk->n == SWEEP_CHUNK) {
+                sweep_pool_publish(st->pool, st->chunk, st->chunk->n);
+                st->chunk = NULL;
             }
         }
+    } else if (st->sharded) {
+        shard_cache_replay(st->sharded, recs, n);
+    } else if (st->hier) {
+        hier_replay(st->hier, recs, n);
+    } else {
+        for (int c = 0; c < st->num_caches; c++)
+            cache_sim_replay(&st->caches[c], recs, n);
     }
 
-    return 1;
+    if (st->procs && n > 0) {
+        st->procs[proc].cycles += *stage_cycles(st) - cycles0;
+        st->procs[proc].instructions += stage_instructions(st) - instructions0;
+    }
 }
 
-// CACHE SIM STRUCTS (Milestone 3)
-
-typedef enum {
-    POLICY_RR = 0,
-    POLICY_RND = 1
-} ReplacementPolicy;
+static void cache_stage_replay(CacheStage *st, const PhysRecord *recs, size_t n,
+                               int proc) {
+    PROFILE_BEGIN(t);
+    cache_stage_run(st, recs, n, proc);
+    PROFILE_END(PROFILE_CACHE, t, n);
+    interval_check(st->sampler);
+}
 
-typedef struct {
-    int cache_size_kb;
-    int block_size;
-    int associativity;
-    ReplacementPolicy policy;
+// Records to translate next: a full batch, or up to the next --interval row
+static size_t cache_stage_batch(const CacheStage *st) {
+    return st->sampler ? interval_batch(st->sampler, PHYS_BATCH) : PHYS_BATCH;
+}
 
-    int num_blocks;
-    int num_sets;
-    int offset_bits;
-    int index_bits;
-    int tag_bits;
-
-    // stats
-    unsigned long long accesses;
-    unsigned long long hits;
-    unsigned long long misses;
-    unsigned long long compulsory_misses;
-    unsigned long long conflict_misses;
-
-    unsigned long long instruction_bytes;
-    unsigned long long srcdst_bytes;
-    unsigned long long total_cycles;
-    unsigned long long total_instructions;
-
-    // arrays 
-    unsigned int *rr_next;          // one per set
-    unsigned long long *tags;       // [num_sets * ways]
-    unsigned char *valid;           // [num_sets * ways]
-} CacheSim;
-
-static void cache_sim_init(CacheSim *cs,
-                           int cache_size_kb,
-                           int block_size,
-                           int associativity,
-                           ReplacementPolicy policy) {
-    if (!cs) return;
-
-    cs->cache_size_kb = cache_size_kb;
-    cs->block_size = block_size;
-    cs->associativity = associativity;
-    cs->policy = policy;
-
-    cs->num_blocks = (cache_size_kb * 1024) / block_size;
-    cs->num_sets = cs->num_blocks / associativity;
-    cs->offset_bits = (int)log2(block_size);
-    cs->index_bits = (int)log2(cs->num_sets);
-    cs->tag_bits = 32 - cs->offset_bits - cs->index_bits; // assume 32-bit PA
-
-    cs->accesses = 0;
-    cs->hits = 0;
-    cs->misses = 0;
-    cs->compulsory_misses = 0;
-    cs->conflict_misses = 0;
-    cs->instruction_bytes = 0;
-    cs->srcdst_bytes = 0;
-    cs->total_cycles = 0;
-    cs->total_instructions = 0;
-
-    size_t nlines = (size_t)cs->num_sets * (size_t)associativity;
-    cs->tags = (unsigned long long *)malloc(nlines * sizeof(unsigned long long));
-    cs->valid = (unsigned char *)calloc(nlines, sizeof(unsigned char));
-    cs->rr_next = (unsigned int *)calloc(cs->num_sets, sizeof(unsigned int));
-
-    if (!cs->tags || !cs->valid || !cs->rr_next) {
-        fprintf(stderr, "Error: cache_sim_init out of memory.\n");
-        exit(1);
+static void cache_stage_flush(CacheStage *st) {
+    if (st->pool && st->chunk) {
+        sweep_pool_publish(st->pool, st->chunk, st->chunk->n);
+        st->chunk = NULL;
     }
 }
 
-static void cache_sim_free(CacheSim *cs) {
-    if (!cs) return;
-    free(cs->tags);
-    free(cs->valid);
-    free(cs->rr_next);
-    cs->tags = NULL;
-    cs->valid = NULL;
-    cs->rr_next = NULL;
+// RESULTS (Milestone 3)
+
+// Blocks never filled, and their share of the implementation in KB
+static unsigned long long cache_unused(const CacheSim *cs, const CacheCalc *calc,
+                                       double *unused_kb) {
+    unsigned long long unused_blocks =
+        ((unsigned long long)cs->num_blocks > cs->compulsory_misses)
+            ? ((unsigned long long)cs->num_blocks - cs->compulsory_misses)
+            : 0;
+    double overhead_per_block =
+        (cs->num_blocks > 0)
+            ? ((double)calc->total_overhead / (double)cs->num_blocks)
+            : 0.0;
+    *unused_kb =
+        ((double)unused_blocks *
+         ((double)cs->block_size + overhead_per_block)) / 1024.0;
+    return unused_blocks;
 }
 
-// One cache access for ONE block 
-static void cache_access_block(CacheSim *cs, unsigned long long phys_addr) {
-    unsigned long long block_num = phys_addr / (unsigned long long)cs->block_size;
-    int set_index = (int)(block_num % (unsigned long long)cs->num_sets);
-    unsigned long long tag = block_num / (unsigned long long)cs->num_sets;
+// --prefetch: accuracy = used / filled, coverage = share of the misses
+// without prefetching that it removed, timeliness = used before arrival
+static void prefetch_rates(const CacheSim *cs, double *accuracy, double *coverage,
+                           double *timeliness) {
+    unsigned long long used = cs->prefetch_useful;
+    *accuracy = cs->prefetch_fills ? 100.0 * (double)used / (double)cs->prefetch_fills
+                                   : 0.0;
+    *coverage = (used + cs->misses) ? 100.0 * (double)used / (double)(used + cs->misses)
+                                    : 0.0;
+    *timeliness = used ? 100.0 * (double)(used - cs->prefetch_late) / (double)used
+                       : 0.0;
+}
 
-    int base = set_index * cs->associativity;
+static void print_prefetch_results(const CacheSim *cs) {
+    double accuracy, coverage, timeliness;
+    prefetch_rates(cs, &accuracy, &coverage, &timeliness);
+    printf("Prefetch Requests:\t%llu (%s)\n", cs->prefetcher->issued,
+           prefetch_kind_name(cs->prefetcher->cfg.kind));
+    printf(" Prefetch Fills:\t%llu\n", cs->prefetch_fills);
+    printf(" Useful Prefetches:\t%llu (%llu late)\n", cs->prefetch_useful,
+           cs->prefetch_late);
+    printf(" Unused Prefetches:\t%llu\n", cs->prefetch_unused);
+    printf(" Accuracy:\t\t%.2f%%\n", accuracy);
+    printf(" Coverage:\t\t%.2f%%\n", coverage);
+    printf(" Timeliness:\t\t%.2f%%\n", timeliness);
+}
 
-    cs->accesses++;
+static void print_cache_results(const CacheSim *cs, const CacheCalc *calc) {
+    printf(" CACHE SIMULATION RESULTS:\n\n");
+    printf("Total Cache Accesses:\t%llu (%llu addresses)\n",
+           cs->accesses,
+           (unsigned long long)(cs->total_instructions +
+                                (cs->srcdst_bytes / 4)));
+    printf(" Instruction Bytes:\t%llu\n", cs->instruction_bytes);
+    printf(" SrcDst Bytes:\t%llu\n", cs->srcdst_bytes);
+
+    printf("Cache Hits:\t\t%llu\n", cs->hits);
+    printf("Cache Misses:\t\t%llu\n", cs->misses);
+    printf("Compulsory Misses:\t%llu\n", cs->compulsory_misses);
+    printf(" Conflict Misses:\t%llu\n", cs->conflict_misses);
+    if (cs->write_policy != WRITE_AS_READ) {
+        printf("Writebacks:\t\t%llu\n", cs->writebacks);
+        printf("Memory Writes:\t\t%llu\n", cs->memory_writes);
+    }
+    if (cs->shadow) {
+        printf("3C Compulsory:\t\t%llu\n", cs->class_compulsory);
+        printf(" 3C Capacity:\t\t%llu\n", cs->class_capacity);
+        printf(" 3C Conflict:\t\t%llu\n", cs->class_conflict);
+    }
+    if (cs->victim)
+        printf("Victim Cache Hits:\t%llu (%d entries)\n", cs->victim->hits,
+               cs->victim->entries);
+    if (cs->prefetcher)
+        print_prefetch_results(cs);
 
-    // check for hit 
-    for (int way = 0; way < cs->associativity; way++) {
-        int idx = base + way;
-        if (cs->valid[idx] && cs->tags[idx] == tag) {
-            cs->hits++;
-            cs->total_cycles += 1; // 1 cycle for cache hit
-            return;
+    double hit_rate =
+        (cs->accesses > 0)
+            ? (100.0 * (double)cs->hits / (double)cs->accesses)
+            : 0.0;
+    double miss_rate = 100.0 - hit_rate;
+
+    printf("\nACHE HIT & MISS RATE: \n");
+    printf("Hit  Rate:\t\t%.4f%%\n", hit_rate);
+    printf("Miss Rate:\t\t%.4f%%\n", miss_rate);
+
+    double cpi =
+        (cs->total_instructions > 0)
+            ? ((double)cs->total_cycles /
+               (double)cs->total_instructions)
+            : 0.0;
+    printf("CPI:\t\t\t%.2f Cycles/Instruction (%llu)\n",
+           cpi, cs->total_cycles);
+
+    // unused cache space/blocks
+    double unused_kb;
+    unsigned long long unused_blocks = cache_unused(cs, calc, &unused_kb);
+    double waste = unused_kb * 0.07;
+
+    printf("Unused Cache Space:\t%.2f KB / %.2f KB = %.2f%%  Waste: $%.2f/chip\n",
+           unused_kb,
+           calc->implementation_memory_kb,
+           (calc->implementation_memory_kb > 0.0)
+               ? (100.0 * unused_kb / calc->implementation_memory_kb)
+               : 0.0,
+           waste);
+    printf("Unused Cache Blocks:\t%llu / %d\n",
+           unused_blocks, cs->num_blocks);
+}
+
+// Sweep mode: one row per configuration
+static void print_sweep_results(const CacheSim *caches, int num_caches,
+                                int physical_mem) {
+    printf(" CACHE SWEEP RESULTS: %d configurations\n\n", num_caches);
+    int writes = num_caches > 0 && caches[0].write_policy != WRITE_AS_READ;
+    int classify = num_caches > 0 && caches[0].shadow != NULL;
+    int victim = num_caches > 0 && caches[0].victim != NULL;
+    int prefetch = num_caches > 0 && caches[0].prefetcher != NULL;
+    printf("Size KB\tBlock\tAssoc\tPolicy\tAccesses\tHits\tMisses\t"
+           "Compulsory\tConflict\tHit Rate\tCPI\tCost%s%s%s%s\n",
+           writes ? "\tWritebacks\tMemory Writes" : "",
+           classify ? "\t3C Compulsory\t3C Capacity\t3C Conflict" : "",
+           victim ? "\tVictim Hits" : "",
+           prefetch ? "\tPrefetch Fills\tAccuracy\tCoverage\tTimeliness" : "");
+    for (int c = 0; c < num_caches; c++) {
+        const CacheSim *cs = &caches[c];
+        CacheCalc calc;
+        cache_calc(&calc, cs->cache_size_kb, cs->block_size, cs->associativity,
+                   physical_mem);
+        double hit_rate =
+            (cs->accesses > 0)
+                ? (100.0 * (double)cs->hits / (double)cs->accesses)
+                : 0.0;
+        double cpi =
+            (cs->total_instructions > 0)
+                ? ((double)cs->total_cycles / (double)cs->total_instructions)
+                : 0.0;
+        printf("%d\t%d\t%d\t%s\t%llu\t%llu\t%llu\t%llu\t%llu\t%.4f%%\t%.2f\t$%.2f",
+               cs->cache_size_kb, cs->block_size, cs->associativity,
+               cache_policy_name(cs->policy),
+               cs->accesses, cs->hits, cs->misses,
+               cs->compulsory_misses, cs->conflict_misses,
+               hit_rate, cpi, calc.cost);
+        if (writes)
+            printf("\t%llu\t%llu", cs->writebacks, cs->memory_writes);
+        if (classify)
+            printf("\t%llu\t%llu\t%llu", cs->class_compulsory, cs->class_capacity,
+                   cs->class_conflict);
+        if (victim)
+            printf("\t%llu", cs->victim->hits);
+        if (prefetch) {
+            double accuracy, coverage, timeliness;
+            prefetch_rates(cs, &accuracy, &coverage, &timeliness);
+            printf("\t%llu\t%.2f%%\t%.2f%%\t%.2f%%", cs->prefetch_fills, accuracy,
+                   coverage, timeliness);
         }
+        printf("\n");
     }
+}
 
-    // miss 
-    cs->misses++;
+// Hierarchy mode: one row per level, then memory and the overall CPI
+static void print_hierarchy_results(const Hierarchy *h) {
+    printf(" CACHE HIERARCHY RESULTS: %s\n\n", inclusion_mode_name(h->mode));
+    printf("Level\tSize KB\tBlock\tAssoc\tPolicy\tLatency\tAccesses\tHits\t"
+           "Misses\tHit Rate\n");
+    for (int l = 0; l < h->num_levels; l++) {
+        const CacheSim *cs = &h->cache[l];
+        double hit_rate =
+            (cs->accesses > 0)
+                ? (100.0 * (double)cs->hits / (double)cs->accesses)
+                : 0.0;
+        printf("%s\t%d\t%d\t%d\t%s\t%d\t%llu\t%llu\t%llu\t%.4f%%\n",
+               level_name(l), cs->cache_size_kb, cs->block_size, cs->associativity,
+               cache_policy_name(cs->policy), h->latency[l],
+               cs->accesses, cs->hits, cs->misses, hit_rate);
+    }
+    printf("\nMemory Accesses:\t%llu (%d cycles each)\n", h->mem_accesses,
+           h->mem_latency);
+    if (h->mode == INCLUSION_INCLUSIVE)
+        printf("Back-Invalidations:\t%llu\n", h->back_invalidations);
+    if (h->mode == INCLUSION_EXCLUSIVE)
+        printf("L1I/L1D Transfers:\t%llu\n", h->sibling_transfers);
 
-    // cost to fill this cache block from memory (bus 32-bit) 
-    int words_per_block = (cs->block_size + 3) / 4; // ceil(block_size/4)
-    cs->total_cycles += 4 * words_per_block;        // 4 cycles per memory read
+    double cpi =
+        (h->total_instructions > 0)
+            ? ((double)h->total_cycles / (double)h->total_instructions)
+            : 0.0;
+    printf("CPI:\t\t\t%.2f Cycles/Instruction (%llu)\n", cpi, h->total_cycles);
+}
 
-    // find victim 
-    int victim = -1;
-    for (int way = 0; way < cs->associativity; way++) {
-        int idx = base + way;
-        if (!cs->valid[idx]) {
-            victim = idx;
-            cs->compulsory_misses++;
-            break;
-        }
+static void print_tlb_results(const Tlb *tlb) {
+    printf("***** TLB SIMULATION RESULTS *****\n\n");
+    printf("Level\tEntries\tAssoc\tPolicy\tLatency\tLookups\tHits\tHit Rate\n");
+    for (int l = 0; l < tlb->num_levels; l++) {
+        const TlbLevel *lv = &tlb->level[l];
+        double hit_rate =
+            (lv->lookups > 0) ? (100.0 * (double)lv->hits / (double)lv->lookups) : 0.0;
+        printf("L%d TLB\t%d\t%d\t%s\t%d\t%llu\t%llu\t%.4f%%\n", l + 1,
+               lv->cfg.entries, lv->cfg.associativity, cache_policy_name(lv->cfg.policy),
+               lv->cfg.latency, lv->lookups, lv->hits, hit_rate);
+    }
+    printf("\nPage Walks:\t\t%llu (%d cycles each)\n", tlb->walks, tlb->walk_cycles);
+    printf("Translation Cycles:\t%llu\n\n", tlb->cycles);
+}
+
+// --schedule: context switches and each process's share of the cycles
+static void print_schedule_results(const ProcStats *procs, const PageTable *pt,
+                                   const TraceSet *traces, const CacheStage *st) {
+    printf("***** PROCESS SCHEDULING RESULTS *****\n\n");
+    printf("Context Switches:\t%llu (%d cycles each)\n\n", st->switches,
+           st->switch_cost);
+    printf("Process\tInstructions\tSwitches In\tPage Faults\tCycles\tCPI\tTrace\n");
+    for (int i = 0; i < traces->count; i++) {
+        if (traces->state[i] == TRACE_FAILED)
+            continue;
+        // cache stage cycles plus this process's page faults and TLB time
+        unsigned long long cycles = procs[i].cycles + 100ULL * pt[i].page_faults +
+                                    pt[i].tlb_cycles;
+        double cpi = (procs[i].instructions > 0)
+                         ? (double)cycles / (double)procs[i].instructions
+                         : 0.0;
+        printf("[%d]\t%llu\t%llu\t%llu\t%llu\t%.2f\t%s\n", i, procs[i].instructions,
+               procs[i].switches_in, pt[i].page_faults, cycles, cpi, traces->names[i]);
     }
+    printf("\n");
+}
 
-    if (victim == -1) {
-        cs->conflict_misses++;
-        if (cs->policy == POLICY_RR) {
-            unsigned int pos = cs->rr_next[set_index] % (unsigned int)cs->associativity;
-            victim = base + (int)pos;
-            cs->rr_next[set_index] = (pos + 1U) % (unsigned int)cs->associativity;
-        } else {
-            int way = rand() % cs->associativity;
-            victim = base + way;
+// LRU miss-ratio curve from one stack-distance pass (--mrc)
+static void print_mrc_results(const StackDist *sd) {
+    printf("\n***** LRU MISS RATIO CURVE *****\n\n");
+    printf("Block Size:\t\t%d bytes\n", sd->block_size);
+    printf("Block Accesses:\t\t%llu (%llu compulsory)\n\n", sd->accesses, sd->cold);
+    printf("Cache Size\tFully Assoc LRU Miss Rate\n");
+    for (int kb = 8; kb <= 8192; kb *= 2) {
+        unsigned long long blocks = (unsigned long long)kb * 1024ULL / sd->block_size;
+        printf("%d KB\t\t%.4f%%\n", kb, 100.0 * stackdist_miss_ratio(sd, blocks));
+    }
+
+    printf("\nSet-Assoc LRU, %d sets:\nAssoc\tCache Size\tMiss Rate\n", sd->num_sets);
+    for (int ways = 1; ways <= SD_MAX_WAYS; ways *= 2) {
+        double kb = (double)sd->num_sets * ways * sd->block_size / 1024.0;
+        printf("%d\t%.0f KB\t\t%.4f%%\n", ways, kb,
+               100.0 * stackdist_set_miss_ratio(sd, ways));
+    }
+}
+
+// MACHINE-READABLE RESULTS (--format=json|csv)
+//
+// One "process" record per trace, then one "run" record per cache
+// configuration (or one for the hierarchy) carrying the inputs, the
+// calculated values, the VM results and that cache's results, so every
+// row stands alone. --mrc adds "mrc" records, --pipeline "stage" ones.
+
+// Run-wide inputs and VM results, repeated in every run record
+typedef struct {
+    char **filenames;
+    int fileCount;
+    int physical_mem;
+    double physical_mem_used;
+    int instruction_limit;
+    WritePolicy write_policy;
+    int write_allocate;
+    PageReplacement page_repl;
+    const char *prefetch;        // --prefetch spec, NULL if none
+    int victim_entries;
+    int schedule;
+    int switch_cost;
+    unsigned long long switches;
+
+    unsigned long long phys_pages;
+    unsigned long long system_pages;
+    unsigned long long user_pages;
+    int pte_bits;
+    unsigned long long total_pt_bytes;
+
+    const VmStats *vm;
+    const PageTable *pt;
+    const Tlb *tlb;              // NULL without --tlb
+} RunSummary;
+
+static void report_run_fields(Report *r, const RunSummary *run) {
+    report_list(r, "trace_files", run->filenames, run->fileCount);
+    report_int(r, "processes", run->fileCount);
+    report_int(r, "physical_mem_mb", run->physical_mem);
+    report_double(r, "physical_mem_used_pct", run->physical_mem_used);
+    report_int(r, "instructions_per_slice", run->instruction_limit);
+    report_str(r, "write_policy",
+               run->write_policy != WRITE_AS_READ
+                   ? cache_write_policy_name(run->write_policy, run->write_allocate)
+                   : "");
+    report_str(r, "page_replacement",
+               run->page_repl != PAGE_REPL_NONE ? page_repl_name(run->page_repl) : "");
+    report_str(r, "prefetcher", run->prefetch);
+    report_int(r, "victim_entries", run->victim_entries);
+    if (run->schedule) {
+        report_u64(r, "context_switches", run->switches);
+        report_int(r, "switch_cost", run->switch_cost);
+    }
+
+    report_u64(r, "physical_pages", run->phys_pages);
+    report_u64(r, "system_pages", run->system_pages);
+    report_int(r, "pte_bits", run->pte_bits);
+    report_u64(r, "page_table_bytes", run->total_pt_bytes);
+
+    const VmStats *vm = run->vm;
+    unsigned long long used = 0;
+    size_t allocated = 0;
+    for (int i = 0; i < run->fileCount; i++) {
+        used += run->pt[i].used;
+        allocated += pt_bytes(&run->pt[i]);
+    }
+    report_u64(r, "user_pages", run->user_pages);
+    report_u64(r, "virtual_pages_mapped", vm->virtual_pages_mapped);
+    report_u64(r, "page_table_hits", vm->page_table_hits);
+    report_u64(r, "pages_from_free", vm->pages_from_free);
+    report_u64(r, "page_faults", vm->total_page_faults);
+    report_u64(r, "pages_evicted", vm->pages_evicted);
+    report_u64(r, "used_page_table_entries", used);
+    report_double(r, "page_table_wasted_bytes",
+                  ((double)VA_PAGES_PER_PROC * run->fileCount - (double)used) *
+                      (double)run->pte_bits / 8.0);
+    report_u64(r, "page_table_allocated_bytes", (unsigned long long)allocated);
+
+    if (run->tlb) {
+        for (int l = 0; l < run->tlb->num_levels; l++) {
+            const TlbLevel *lv = &run->tlb->level[l];
+            report_u64(r, l ? "tlb2_lookups" : "tlb1_lookups", lv->lookups);
+            report_u64(r, l ? "tlb2_hits" : "tlb1_hits", lv->hits);
         }
+        report_u64(r, "page_walks", run->tlb->walks);
+        report_u64(r, "translation_cycles", run->tlb->cycles);
     }
+}
 
-    cs->valid[victim] = 1;
-    cs->tags[victim] = tag;
+static void report_cache_fields(Report *r, const CacheSim *cs, int physical_mem) {
+    CacheCalc calc;
+    cache_calc(&calc, cs->cache_size_kb, cs->block_size, cs->associativity,
+               physical_mem);
+    report_int(r, "cache_size_kb", cs->cache_size_kb);
+    report_int(r, "block_size", cs->block_size);
+    report_int(r, "associativity", cs->associativity);
+    report_str(r, "replacement_policy", cache_policy_name(cs->policy));
+
+    report_int(r, "total_blocks", calc.num_blocks);
+    report_int(r, "tag_bits", calc.tag_size);
+    report_int(r, "index_bits", calc.index_bits);
+    report_int(r, "rows", calc.num_rows);
+    report_int(r, "overhead_bytes", calc.total_overhead);
+    report_int(r, "implementation_memory_bytes", calc.implementation_memory);
+    report_double(r, "cost", calc.cost);
+
+    double hit_rate =
+        (cs->accesses > 0) ? (100.0 * (double)cs->hits / (double)cs->accesses) : 0.0;
+    double cpi = (cs->total_instructions > 0)
+                     ? ((double)cs->total_cycles / (double)cs->total_instructions)
+                     : 0.0;
+    double unused_kb;
+    unsigned long long unused_blocks = cache_unused(cs, &calc, &unused_kb);
+    report_u64(r, "accesses", cs->accesses);
+    report_u64(r, "addresses", cs->total_instructions + cs->srcdst_bytes / 4);
+    report_u64(r, "instruction_bytes", cs->instruction_bytes);
+    report_u64(r, "srcdst_bytes", cs->srcdst_bytes);
+    report_u64(r, "hits", cs->hits);
+    report_u64(r, "misses", cs->misses);
+    report_u64(r, "compulsory_misses", cs->compulsory_misses);
+    report_u64(r, "conflict_misses", cs->conflict_misses);
+    report_double(r, "hit_rate_pct", hit_rate);
+    report_double(r, "miss_rate_pct", 100.0 - hit_rate);
+    report_u64(r, "instructions", cs->total_instructions);
+    report_u64(r, "total_cycles", cs->total_cycles);
+    report_double(r, "cpi", cpi);
+    report_double(r, "unused_kb", unused_kb);
+    report_u64(r, "unused_blocks", unused_blocks);
+    report_double(r, "waste", unused_kb * 0.07);
+    if (cs->write_policy != WRITE_AS_READ) {
+        report_u64(r, "writebacks", cs->writebacks);
+        report_u64(r, "memory_writes", cs->memory_writes);
+    }
+    if (cs->shadow) {
+        report_u64(r, "3c_compulsory", cs->class_compulsory);
+        report_u64(r, "3c_capacity", cs->class_capacity);
+        report_u64(r, "3c_conflict", cs->class_conflict);
+    }
+    if (cs->victim)
+        report_u64(r, "victim_hits", cs->victim->hits);
+    if (cs->prefetcher) {
+        double accuracy, coverage, timeliness;
+        prefetch_rates(cs, &accuracy, &coverage, &timeliness);
+        report_u64(r, "prefetch_requests", cs->prefetcher->issued);
+        report_u64(r, "prefetch_fills", cs->prefetch_fills);
+        report_u64(r, "prefetch_useful", cs->prefetch_useful);
+        report_u64(r, "prefetch_late", cs->prefetch_late);
+        report_u64(r, "prefetch_unused", cs->prefetch_unused);
+        report_double(r, "prefetch_accuracy_pct", accuracy);
+        report_double(r, "prefetch_coverage_pct", coverage);
+        report_double(r, "prefetch_timeliness_pct", timeliness);
+    }
+}
+
+// "l2_hits" etc. for one level's field
+static const char *level_key(char *key, size_t size, int level, const char *field) {
+    static const char *prefix[LEVEL_COUNT] = {"l1i", "l1d", "l2", "l3"};
+    snprintf(key, size, "%s_%s", prefix[level], field);
+    return key;
 }
 
-// Access a range [phys_addr, phys_addr + len - 1], may touch multiple blocks 
-static void cache_access_range(CacheSim *cs,
-                               unsigned long long phys_addr,
-                               int len) {
-    unsigned long long first_block =
-        phys_addr / (unsigned long long)cs->block_size;
-    unsigned long long last_block =
-        (phys_addr + (unsigned long long)len - 1ULL) /
-        (unsigned long long)cs->block_size;
-
-    for (unsigned long long b = first_block; b <= last_block; b++) {
-        unsigned long long block_addr =
-            b * (unsigned long long)cs->block_size;
-        cache_access_block(cs, block_addr);
+static void report_hierarchy_fields(Report *r, const Hierarchy *h) {
+    char key[48];
+    report_str(r, "inclusion", inclusion_mode_name(h->mode));
+    for (int l = 0; l < h->num_levels; l++) {
+        const CacheSim *cs = &h->cache[l];
+#define LEVEL_KEY(field) level_key(key, sizeof(key), l, field)
+        report_int(r, LEVEL_KEY("size_kb"), cs->cache_size_kb);
+        report_int(r, LEVEL_KEY("block_size"), cs->block_size);
+        report_int(r, LEVEL_KEY("associativity"), cs->associativity);
+        report_str(r, LEVEL_KEY("replacement_policy"), cache_policy_name(cs->policy));
+        report_int(r, LEVEL_KEY("latency"), h->latency[l]);
+        report_u64(r, LEVEL_KEY("accesses"), cs->accesses);
+        report_u64(r, LEVEL_KEY("hits"), cs->hits);
+        report_u64(r, LEVEL_KEY("misses"), cs->misses);
+        report_double(r, LEVEL_KEY("hit_rate_pct"),
+                      cs->accesses > 0 ? 100.0 * (double)cs->hits / (double)cs->accesses
+                                       : 0.0);
+#undef LEVEL_KEY
+    }
+    report_u64(r, "memory_accesses", h->mem_accesses);
+    report_int(r, "memory_latency", h->mem_latency);
+    report_u64(r, "back_invalidations", h->back_invalidations);
+    report_u64(r, "sibling_transfers", h->sibling_transfers);
+    report_u64(r, "instructions", h->total_instructions);
+    report_u64(r, "total_cycles", h->total_cycles);
+    report_double(r, "cpi", h->total_instructions > 0
+                                ? (double)h->total_cycles / (double)h->total_instructions
+                                : 0.0);
+}
+
+static void report_processes(Report *r, const RunSummary *run, const TraceSet *traces,
+                             const ProcStats *procs) {
+    for (int i = 0; i < run->fileCount; i++) {
+        const PageTable *pt = &run->pt[i];
+        report_begin(r, "process");
+        report_int(r, "process", i);
+        report_str(r, "trace", run->filenames[i]);
+        report_int(r, "opened", traces->state[i] != TRACE_FAILED);
+        report_u64(r, "used_page_table_entries", pt->used);
+        report_double(r, "used_page_table_pct",
+                      100.0 * (double)pt->used / (double)VA_PAGES_PER_PROC);
+        report_double(r, "page_table_wasted_bytes",
+                      ((double)VA_PAGES_PER_PROC - (double)pt->used) *
+                          (double)run->pte_bits / 8.0);
+        report_u64(r, "page_table_allocated_bytes", (unsigned long long)pt_bytes(pt));
+        report_u64(r, "page_faults", pt->page_faults);
+        if (procs) {
+            unsigned long long cycles = procs[i].cycles + 100ULL * pt->page_faults +
+                                        pt->tlb_cycles;
+            report_u64(r, "instructions", procs[i].instructions);
+            report_u64(r, "switches_in", procs[i].switches_in);
+            report_u64(r, "cycles", cycles);
+            report_double(r, "cpi", procs[i].instructions > 0
+                                        ? (double)cycles / (double)procs[i].instructions
+                                        : 0.0);
+        }
+        report_end(r);
+    }
+}
+
+static void report_mrc(Report *r, const StackDist *sd) {
+    for (int kb = 8; kb <= 8192; kb *= 2) {
+        unsigned long long blocks = (unsigned long long)kb * 1024ULL / sd->block_size;
+        report_begin(r, "mrc");
+        report_str(r, "organization", "fully_associative");
+        report_int(r, "cache_size_kb", kb);
+        report_int(r, "associativity", 0);
+        report_double(r, "miss_rate_pct", 100.0 * stackdist_miss_ratio(sd, blocks));
+        report_end(r);
+    }
+    for (int ways = 1; ways <= SD_MAX_WAYS; ways *= 2) {
+        report_begin(r, "mrc");
+        report_str(r, "organization", "set_associative");
+        report_int(r, "cache_size_kb", sd->num_sets * ways * sd->block_size / 1024);
+        report_int(r, "associativity", ways);
+        report_double(r, "miss_rate_pct", 100.0 * stackdist_set_miss_ratio(sd, ways));
+        report_end(r);
     }
 }
 
 //=====MAIN=====
 
 int main(int argc, char *argv[]) {
-    int cache_size = 0;
-    int block_size = 0;
-    int associativity = 0;
+    int cache_sizes[SWEEP_MAX] = {0};
+    int block_sizes[SWEEP_MAX] = {0};
+    int assocs[SWEEP_MAX] = {0};
+    ReplacementPolicy policies[SWEEP_MAX] = {POLICY_RR};
+    int n_sizes = 1, n_blocks = 1, n_assocs = 1, n_policies = 1;
+    const char *size_arg = "", *block_arg = "", *assoc_arg = "";
     char replacement_policy_str[32] = "";
-    ReplacementPolicy policy = POLICY_RR;
     int physical_mem = 0;
     double physical_mem_used = 0.0;
     int instruction_limit = -1;
-    char *filenames[FILE_NUM];
+    int mrc = 0;
+    int pipelined = 0;
+    int profile = 0;
+    int num_threads = 1;
+    unsigned long long seed = 1;
+    const char *level_arg[LEVEL_COUNT] = {NULL};
+    InclusionMode inclusion = INCLUSION_NINE;
+    int mem_latency = -1;
+    WritePolicy write_policy = WRITE_AS_READ;
+    TlbConfig tlb_cfg[2] = {{64, 4, POLICY_LRU, 0}, {1024, 8, POLICY_LRU, 7}};
+    int classify = 0;
+    int victim_entries = 0;
+    const char *prefetch_arg = NULL;
+    PrefetchConfig prefetch_cfg = {PREFETCH_NONE, 1, 0};
+    const char *tlb_arg[2] = {NULL, NULL};
+    int tlb_walk = 30;
+    PageReplacement page_repl = PAGE_REPL_NONE;
+    int flush_evicted = 0;
+    int schedule = 0;
+    int switch_cost = 0;
+    const char *flush_on_switch = NULL;
+    int write_allocate = 1;
+    int pt_memory = 0;
+    const char *interval_arg = NULL;
+    const char *interval_file = "intervals.csv";
+    IntervalUnit interval_unit = INTERVAL_INSTRUCTIONS;
+    unsigned long long interval_every = 0;
+    OutputFormat format = FORMAT_TEXT;
+    char **filenames = NULL;
     int fileCount = 0;
 
     if (argc < 2) {
         printf("Usage: VMCacheSim.exe -s <cacheKB> -b <blocksize> -a <associativity> "
-               "-r <rr/rnd> -p <physmemMB> -u <mem used> -f <file1> -f <file2>...\n");
+               "-r <rr/rnd/lru/plru/nru/srrip/brrip/drrip> -p <physmemMB> -u <mem used> -f <file1> -f <file2>...\n");
+        printf("Sweep: -s/-b/-a/-r also take lists (8,16,64) or power-of-two "
+               "ranges (8-8192)\n");
+        printf("  --mrc\tLRU miss-ratio curve for 8KB-8192KB from one pass\n");
+        printf("  -t <threads>\tsimulate the configurations on a worker pool "
+               "(one cache: split its sets across threads)\n");
+        printf("  -w <wb/wt>\twrite-back or write-through stores with dirty bits "
+               "(default: stores are simulated as reads)\n");
+        printf("  --no-write-allocate\ta store miss writes memory without "
+               "filling the block\n");
+        printf("  --prefetch <next[:lines]/stride[:entries[:degree]]/"
+               "stream[:buffers[:depth]]>\thardware prefetcher for each cache\n");
+        printf("  --3c\tclassify misses as compulsory/capacity/conflict against a "
+               "fully associative LRU cache of the same size\n");
+        printf("  --victim <entries>\tfully associative victim cache behind each "
+               "cache (0-%d, 0 = none)\n", VICTIM_MAX_ENTRIES);
+        printf("  --tlb <entries:assoc[:policy[:latency]]>\tL1 TLB in front of the "
+               "page tables (policy rr/rnd/lru, default 64:4:lru:0)\n");
+        printf("  --tlb2 <entries:assoc[:policy[:latency]]>\tL2 TLB (default "
+               "1024:8:lru:7)\n");
+        printf("  --tlb-walk <cycles>\tpage walk after a TLB miss (default 30)\n");
+        printf("  --page-repl <fifo/clock/lru/random>\treplace pages once the free "
+               "frames run out (default: fault without mapping)\n");
+        printf("  --flush-evicted\tdrop an evicted page's blocks from the caches\n");
+        printf("  --schedule\tinterleave the traces round robin in -n instruction "
+               "slices until all end\n");
+        printf("  --switch-cost <cycles>\tcycles per context switch (default 0)\n");
+        printf("  --flush-on-switch <cache/tlb/all>\tflush on every context switch\n");
+        printf("  --pt-memory\treport the memory each radix page table allocated\n");
+        printf("  --seed <n>\tseed of the rnd/brrip/drrip random choices (default 1)\n");
+        printf("  --interval <count>[:instructions/accesses]\tappend the VM and "
+               "cache counters to a CSV row every count instructions or accesses\n");
+        printf("  --interval-file <path>\twhere --interval writes (default "
+               "intervals.csv)\n");
+        printf("  --format <text/json/csv>\tresults as JSON lines or CSV rows, one "
+               "record per configuration, flushed as each completes\n");
+        printf("  --pipeline\tparse, translate and simulate on separate threads "
+               "and report per-stage throughput\n");
+        printf("  --profile\ttime the simulator's own stages (read, parse, touch, "
+               "translate, cache, report); needs 'make PROFILE=1'\n");
+        printf("  --l2 <KB:block:assoc[:policy[:latency]]>\tsimulate L1I/L1D/L2; "
+               "also --l1i, --l1d (default -s/-b/-a/-r) and --l3\n");
+        printf("  --inclusion <nine/inclusive/exclusive>\thierarchy inclusion "
+               "(default nine)\n");
+        printf("  --mem-latency <cycles>\tcycles when every level misses "
+               "(default 4 per word of the last-level block)\n");
         return 1;
     }
 
-    // parse command line 
+    // one process per -f, as many as the command line holds
+    filenames = (char **)malloc((size_t)argc * sizeof(char *));
+    if (!filenames) {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+
+    // parse command line
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-s") == 0) {
-            cache_size = atoi(argv[++i]);
+            size_arg = argv[++i];
+            n_sizes = parse_int_list(size_arg, cache_sizes, SWEEP_MAX);
         } else if (strcmp(argv[i], "-b") == 0) {
-            block_size = atoi(argv[++i]);
+            block_arg = argv[++i];
+            n_blocks = parse_int_list(block_arg, block_sizes, SWEEP_MAX);
         } else if (strcmp(argv[i], "-a") == 0) {
-            associativity = atoi(argv[++i]);
+            assoc_arg = argv[++i];
+            n_assocs = parse_int_list(assoc_arg, assocs, SWEEP_MAX);
         } else if (strcmp(argv[i], "-r") == 0) {
             char *opt = argv[++i];
-            if (strcmp(opt, "rr") == 0) {
-                policy = POLICY_RR;
-                strcpy(replacement_policy_str, "Round Robin");
-            } else if (strcmp(opt, "rnd") == 0 || strcmp(opt, "RND") == 0) {
-                policy = POLICY_RND;
-                strcpy(replacement_policy_str, "Random");
-            } else {
-                printf("Error: Replacement policy (-r) must be rr or rnd.\n");
+            n_policies = parse_policy_list(opt, policies, SWEEP_MAX);
+            if (n_policies < 1) {
+                printf("Error: Replacement policy (-r) must be rr, rnd, lru, plru, nru, "
+                       "srrip, brrip or drrip.\n");
                 return 1;
             }
+            if (n_policies == 1)
+                strcpy(replacement_policy_str, cache_policy_name(policies[0]));
+            else
+                snprintf(replacement_policy_str, sizeof(replacement_policy_str),
+                         "%s", opt);
         } else if (strcmp(argv[i], "-p") == 0) {
             physical_mem = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-u") == 0) {
             physical_mem_used = atof(argv[++i]);
         } else if (strcmp(argv[i], "-n") == 0) {
             instruction_limit = atoi(argv[++i]);
-        } else if (strcmp(argv[i], "-f") == 0 && fileCount < FILE_NUM) {
+        } else if (strcmp(argv[i], "-t") == 0) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            if (!cache_write_policy_parse(argv[++i], &write_policy)) {
+                printf("Error: Write policy (-w) must be wb or wt.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--no-write-allocate") == 0) {
+            write_allocate = 0;
+        } else if (strcmp(argv[i], "--3c") == 0) {
+            classify = 1;
+        } else if (strcmp(argv[i], "--victim") == 0) {
+            victim_entries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--prefetch") == 0) {
+            prefetch_arg = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0) {
+            interval_arg = argv[++i];
+        } else if (strcmp(argv[i], "--interval-file") == 0) {
+            interval_file = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 || strncmp(argv[i], "--format=", 9) == 0) {
+            const char *opt = argv[i][8] == '=' ? argv[i] + 9 : argv[++i];
+            if (!output_format_parse(opt, &format)) {
+                printf("Error: Output format (--format) must be text, json or csv.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--tlb") == 0) {
+            tlb_arg[0] = argv[++i];
+        } else if (strcmp(argv[i], "--tlb2") == 0) {
+            tlb_arg[1] = argv[++i];
+        } else if (strcmp(argv[i], "--tlb-walk") == 0) {
+            tlb_walk = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--page-repl") == 0) {
+            if (!page_repl_parse(argv[++i], &page_repl)) {
+                printf("Error: Page replacement (--page-repl) must be fifo, clock, lru "
+                       "or random.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--flush-evicted") == 0) {
+            flush_evicted = 1;
+        } else if (strcmp(argv[i], "--schedule") == 0) {
+            schedule = 1;
+        } else if (strcmp(argv[i], "--switch-cost") == 0) {
+            switch_cost = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--flush-on-switch") == 0) {
+            flush_on_switch = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--pt-memory") == 0) {
+            pt_memory = 1;
+        } else if (strcmp(argv[i], "--mrc") == 0) {
+            mrc = 1;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipelined = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = 1;
+        } else if (strcmp(argv[i], "--l1i") == 0) {
+            level_arg[LEVEL_L1I] = argv[++i];
+        } else if (strcmp(argv[i], "--l1d") == 0) {
+            level_arg[LEVEL_L1D] = argv[++i];
+        } else if (strcmp(argv[i], "--l2") == 0) {
+            level_arg[LEVEL_L2] = argv[++i];
+        } else if (strcmp(argv[i], "--l3") == 0) {
+            level_arg[LEVEL_L3] = argv[++i];
+        } else if (strcmp(argv[i], "--inclusion") == 0) {
+            if (!inclusion_mode_parse(argv[++i], &inclusion)) {
+                printf("Error: Inclusion (--inclusion) must be nine, inclusive or "
+                       "exclusive.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--mem-latency") == 0) {
+            mem_latency = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
             filenames[fileCount++] = argv[++i];
         }
     }
 
-    // validate inputs 
-    if (cache_size < 8 || cache_size > 8192) {
+    // validate inputs (every value of a sweep list)
+    if (!list_in_range(cache_sizes, n_sizes, 8, 8192)) {
         printf("Error: Cache size (-s) must be between 8KB and 8192KB.\n");
         return 1;
     }
-    if (block_size < 8 || block_size > 64) {
+    if (!list_in_range(block_sizes, n_blocks, 8, 64)) {
         printf("Error: Block size (-b) must be between 8 bytes and 64 bytes.\n");
         return 1;
     }
-    if (!(associativity == 1 || associativity == 2 || associativity == 4 ||
-          associativity == 8 || associativity == 16)) {
+    if (!list_in_range(assocs, n_assocs, 1, 16)) {
         printf("Error: Associativity (-a) must be 1, 2, 4, 8, 16.\n");
         return 1;
     }
+    for (int i = 0; i < n_assocs; i++) {
+        if (assocs[i] & (assocs[i] - 1)) {
+            printf("Error: Associativity (-a) must be 1, 2, 4, 8, 16.\n");
+            return 1;
+        }
+    }
     if (physical_mem < 128 || physical_mem > 4096) {
         printf("Error: Physical memory (-p) must be between 128MB and 4096MB.\n");
         return 1;
@@ -406,54 +951,158 @@ int main(int argc, char *argv[]) {
         printf("Error: Instruction (-n) must be >=1 or -1 for max.\n");
         return 1;
     }
-    if (fileCount < 1 || fileCount > 3) {
-        printf("Error: There must be 1 to 3 files using -f.\n");
+    if (fileCount < 1) {
+        printf("Error: There must be at least 1 file using -f.\n");
+        return 1;
+    }
+    if (num_threads < 1) {
+        printf("Error: Threads (-t) must be >= 1.\n");
         return 1;
     }
 
-    srand((unsigned int)time(NULL));
+    // every combination of the -s/-b/-a/-r lists is one cache configuration
+    int num_caches = n_sizes * n_blocks * n_assocs * n_policies;
+    int sweep = num_caches > 1;
+    int cache_size = cache_sizes[0];
+    int block_size = block_sizes[0];
+    int associativity = assocs[0];
+
+    // --l2 switches to a hierarchy; the L1s default to the -s/-b/-a/-r cache
+    int hierarchy = level_arg[LEVEL_L2] != NULL;
+    LevelConfig levels[LEVEL_COUNT];
+    if (!hierarchy && (level_arg[LEVEL_L1I] || level_arg[LEVEL_L1D] ||
+                       level_arg[LEVEL_L3])) {
+        printf("Error: --l1i, --l1d and --l3 need --l2.\n");
+        return 1;
+    }
+    if (hierarchy) {
+        static const int default_latency[LEVEL_COUNT] = {1, 1, 10, 30};
+        static const char *option[LEVEL_COUNT] = {"l1i", "l1d", "l2", "l3"};
+        if (sweep || num_threads > 1) {
+            printf("Error: A cache hierarchy (--l2) takes one -s/-b/-a/-r value "
+                   "and no -t.\n");
+            return 1;
+        }
+        for (int l = 0; l < LEVEL_COUNT; l++) {
+            LevelConfig def = {cache_size, block_size, associativity, policies[0],
+                               default_latency[l]};
+            levels[l] = def;
+            if (level_arg[l] && !level_config_parse(level_arg[l], &levels[l])) {
+                printf("Error: --%s must be KB:block:assoc[:policy[:latency]] with "
+                       "power-of-two block (8-256) and assoc (1-16).\n", option[l]);
+                return 1;
+            }
+            if (inclusion == INCLUSION_EXCLUSIVE && (l != LEVEL_L3 || level_arg[l]) &&
+                levels[l].block_size != levels[LEVEL_L1I].block_size) {
+                printf("Error: An exclusive hierarchy needs one block size on every "
+                       "level.\n");
+                return 1;
+            }
+        }
+        if (mem_latency < 0) {
+            int last = level_arg[LEVEL_L3] ? LEVEL_L3 : LEVEL_L2;
+            mem_latency = 4 * ((levels[last].block_size + 3) / 4);
+        }
+    }
+    if (!write_allocate && write_policy == WRITE_AS_READ) {
+        printf("Error: --no-write-allocate needs -w wb or -w wt.\n");
+        return 1;
+    }
+    if (hierarchy && write_policy != WRITE_AS_READ) {
+        printf("Error: Write policies (-w) are not simulated in a hierarchy (--l2).\n");
+        return 1;
+    }
+    int flush_cache_on_switch = 0, flush_tlb_on_switch = 0;
+    if (flush_on_switch) {
+        flush_cache_on_switch = strcmp(flush_on_switch, "cache") == 0 ||
+                                strcmp(flush_on_switch, "all") == 0;
+        flush_tlb_on_switch = strcmp(flush_on_switch, "tlb") == 0 ||
+                              strcmp(flush_on_switch, "all") == 0;
+        if (!flush_cache_on_switch && !flush_tlb_on_switch) {
+            printf("Error: --flush-on-switch must be cache, tlb or all.\n");
+            return 1;
+        }
+    }
+    if (!schedule && (switch_cost != 0 || flush_on_switch)) {
+        printf("Error: --switch-cost and --flush-on-switch need --schedule.\n");
+        return 1;
+    }
+    if (schedule && instruction_limit == -1) {
+        printf("Error: --schedule needs the time slice as -n <instructions>.\n");
+        return 1;
+    }
+    if (schedule && num_threads > 1) {
+        printf("Error: --schedule runs the caches inline, use -t 1.\n");
+        return 1;
+    }
+    if (switch_cost < 0) {
+        printf("Error: --switch-cost must be >= 0.\n");
+        return 1;
+    }
+    if (flush_evicted && page_repl == PAGE_REPL_NONE) {
+        printf("Error: --flush-evicted needs --page-repl.\n");
+        return 1;
+    }
+    if (prefetch_arg && !prefetch_config_parse(prefetch_arg, &prefetch_cfg)) {
+        printf("Error: --prefetch must be next[:lines], stride[:entries[:degree]] "
+               "or stream[:buffers[:depth]].\n");
+        return 1;
+    }
+    if (victim_entries < 0 || victim_entries > VICTIM_MAX_ENTRIES) {
+        printf("Error: --victim must be 0 to %d entries (0 = none).\n", VICTIM_MAX_ENTRIES);
+        return 1;
+    }
+    if ((prefetch_arg || classify || victim_entries) &&
+        (hierarchy || (!sweep && num_threads > 1))) {
+        printf("Error: --prefetch, --3c and --victim work on -s/-b/-a/-r caches, "
+               "without --l2 or -t on a single cache.\n");
+        return 1;
+    }
+    if (interval_arg && !interval_parse(interval_arg, &interval_unit, &interval_every)) {
+        printf("Error: --interval must be <count>[:instructions/accesses], count >= 1.\n");
+        return 1;
+    }
+    if (interval_arg && (pipelined || num_threads > 1)) {
+        printf("Error: --interval samples the serial loop, without --pipeline or -t.\n");
+        return 1;
+    }
+    FILE *interval_out = NULL;
+    if (interval_arg && !(interval_out = fopen(interval_file, "w"))) {
+        printf("Error: cannot write --interval-file %s.\n", interval_file);
+        return 1;
+    }
+#ifndef PROFILE
+    if (profile) {
+        printf("Error: --profile needs a build with 'make PROFILE=1'.\n");
+        return 1;
+    }
+#endif
+    if (tlb_arg[1] && !tlb_arg[0]) {
+        printf("Error: --tlb2 needs --tlb.\n");
+        return 1;
+    }
+    for (int l = 0; l < 2; l++) {
+        if (tlb_arg[l] && !tlb_config_parse(tlb_arg[l], &tlb_cfg[l])) {
+            printf("Error: --tlb%s must be entries:assoc[:policy[:latency]] with "
+                   "power-of-two entries and assoc (1-%d), policy rr, rnd or lru.\n",
+                   l ? "2" : "", TLB_MAX_WAYS);
+            return 1;
+        }
+    }
+    if (tlb_walk < 0) {
+        printf("Error: --tlb-walk must be >= 0.\n");
+        return 1;
+    }
+    if (!hierarchy && mem_latency >= 0) {
+        printf("Error: --mem-latency needs --l2.\n");
+        return 1;
+    }
 
     /* ========== MILESTONE #1: Input + Calculated values ========== */
-    printf("Cache Simulator - CS 3853 - Team #03\n\n");
-    printf("Trace File(s):\n");
-    for (int i = 0; i < fileCount; i++)
-        printf("\t%s\n", filenames[i]);
-
-    printf("\n***** Cache Input Parameters *****\n\n");
-    printf("Cache Size:\t\t\t\t%d KB\n", cache_size);
-    printf("Block Size:\t\t\t\t%d bytes\n", block_size);
-    printf("Associativity:\t\t\t\t%d\n", associativity);
-    printf("Replacement Policy:\t\t\t%s\n", replacement_policy_str);
-    printf("Physical Memory:\t\t\t%d MB\n", physical_mem);
-    printf("Physical Memory Used by System:\t\t%.1f%%\n", physical_mem_used);
-    printf("Instructions / Time Slice:\t\t%d\n", instruction_limit);
-
-    int num_blocks = (cache_size * 1024) / block_size;
-    int num_rows = num_blocks / associativity;
-    int index_bits = (int)log2(num_rows);
-    int offset_bits = (int)log2(block_size);
-    double phys_mem_bits = log2(pow(2.0, 20.0) * (double)physical_mem);
-    int tag_size = (int)(phys_mem_bits - offset_bits - index_bits);
-
-    int overhead_per_row_bits = associativity * (tag_size + 1); /* tag + valid */
-    int total_overhead =
-        (int)ceil((double)num_rows * (double)overhead_per_row_bits / 8.0);
+    CacheCalc calc;
+    cache_calc(&calc, cache_size, block_size, associativity, physical_mem);
     unsigned long long phys_bytes = ((unsigned long long)physical_mem) << 20;
 
-    int implementation_memory = (cache_size * 1024) + total_overhead;
-    double implementation_memory_kb = implementation_memory / 1024.0;
-    double cost = implementation_memory_kb * 0.07;
-
-    printf("\n***** Cache Calculated Values *****\n\n");
-    printf("Total # Blocks:\t\t\t\t%d\n", num_blocks);
-    printf("Tag Size:\t\t\t\t%d bits\n", tag_size);
-    printf("Index Size:\t\t\t\t%d bits\n", index_bits);
-    printf("Total # Rows:\t\t\t\t%d\n", num_rows);
-    printf("Overhead Size:\t\t\t\t%d bytes\n", total_overhead);
-    printf("Implementation Memory Size:\t\t%.2f KB (%d bytes)\n",
-           implementation_memory_kb, implementation_memory);
-    printf("Cost:\t\t\t\t\t$%.2f @ $0.07 per KB\n", cost);
-
     unsigned long long phys_pages = phys_bytes / PAGE_SIZE;
     unsigned long long system_pages =
         (unsigned long long)(phys_pages * (physical_mem_used / 100.0));
@@ -465,237 +1114,380 @@ int main(int argc, char *argv[]) {
         (unsigned long long)pte_bits;
     unsigned long long total_pt_bytes = total_pt_bits / 8ULL;
 
-    printf("\n***** Physical Memory Calculated Values *****\n\n");
-    printf("Number of Physical Pages:       \t%llu\n", phys_pages);
-    printf("Number of Pages for System:     \t%llu\n", system_pages);
-    printf("Size of Page Table Entry:       \t%d bits\n", pte_bits);
-    printf("Total RAM for Page Table(s):    \t%llu bytes\n", total_pt_bytes);
-
-    /* ========== MILESTONE #2 + #3: VM + Cache simulation ========== */
-
-    FILE *fp[FILE_NUM] = {0};
-    for (int i = 0; i < fileCount; i++) {
-        fp[i] = fopen(filenames[i], "r");
-        if (!fp[i]) {
-            fprintf(stderr, "Warning: cannot open %s — skipping this file.\n",
-                    filenames[i]);
+    if (format == FORMAT_TEXT) {
+        printf("Cache Simulator - CS 3853 - Team #03\n\n");
+        printf("Trace File(s):\n");
+        for (int i = 0; i < fileCount; i++)
+            printf("\t%s\n", filenames[i]);
+
+        printf("\n***** Cache Input Parameters *****\n\n");
+        if (sweep) {
+            printf("Cache Size:\t\t\t\t%s KB\n", size_arg);
+            printf("Block Size:\t\t\t\t%s bytes\n", block_arg);
+            printf("Associativity:\t\t\t\t%s\n", assoc_arg);
+        } else {
+            printf("Cache Size:\t\t\t\t%d KB\n", cache_size);
+            printf("Block Size:\t\t\t\t%d bytes\n", block_size);
+            printf("Associativity:\t\t\t\t%d\n", associativity);
+        }
+        printf("Replacement Policy:\t\t\t%s\n", replacement_policy_str);
+        if (write_policy != WRITE_AS_READ)
+            printf("Write Policy:\t\t\t\t%s\n",
+                   cache_write_policy_name(write_policy, write_allocate));
+        printf("Physical Memory:\t\t\t%d MB\n", physical_mem);
+        printf("Physical Memory Used by System:\t\t%.1f%%\n", physical_mem_used);
+        printf("Instructions / Time Slice:\t\t%d\n", instruction_limit);
+        if (schedule)
+            printf("Scheduling:\t\t\t\tRound robin, %d cycles per switch%s\n",
+                   switch_cost,
+                   flush_on_switch ? (flush_cache_on_switch && flush_tlb_on_switch
+                                          ? ", cache and TLB flushed"
+                                          : flush_cache_on_switch ? ", cache flushed"
+                                                                  : ", TLB flushed")
+                                   : "");
+        if (victim_entries)
+            printf("Victim Cache:\t\t\t\t%d entries\n", victim_entries);
+        if (prefetch_arg)
+            printf("Prefetcher:\t\t\t\t%s\n", prefetch_arg);
+        if (page_repl != PAGE_REPL_NONE)
+            printf("Page Replacement:\t\t\t%s%s\n", page_repl_name(page_repl),
+                   flush_evicted ? ", evicted pages flushed from cache" : "");
+
+        if (!sweep) {
+            printf("\n***** Cache Calculated Values *****\n\n");
+            printf("Total # Blocks:\t\t\t\t%d\n", calc.num_blocks);
+            printf("Tag Size:\t\t\t\t%d bits\n", calc.tag_size);
+            printf("Index Size:\t\t\t\t%d bits\n", calc.index_bits);
+            printf("Total # Rows:\t\t\t\t%d\n", calc.num_rows);
+            printf("Overhead Size:\t\t\t\t%d bytes\n", calc.total_overhead);
+            printf("Implementation Memory Size:\t\t%.2f KB (%d bytes)\n",
+                   calc.implementation_memory_kb, calc.implementation_memory);
+            printf("Cost:\t\t\t\t\t$%.2f @ $0.07 per KB\n", calc.cost);
         }
-    }
 
-    PageTable pt[FILE_NUM];
-    for (int i = 0; i < fileCount; i++) {
-        pt_init(&pt[i]);
+        printf("\n***** Physical Memory Calculated Values *****\n\n");
+        printf("Number of Physical Pages:       \t%llu\n", phys_pages);
+        printf("Number of Pages for System:     \t%llu\n", system_pages);
+        printf("Size of Page Table Entry:       \t%d bits\n", pte_bits);
+        printf("Total RAM for Page Table(s):    \t%llu bytes\n", total_pt_bytes);
     }
 
-    CacheSim cache;
-    cache_sim_init(&cache, cache_size, block_size, associativity, policy);
-
-    unsigned long long page_table_hits = 0;
-    unsigned long long pages_from_free = 0;
-    unsigned long long total_page_faults = 0;
-    unsigned long long virtual_pages_mapped = 0;
+    /* ========== MILESTONE #2 + #3: VM + Cache simulation ========== */
 
-    unsigned long long free_ppn_left = user_pages;
-    unsigned long long next_ppn = 0;
+    profile_start();
 
-    char line1[256], line2[256];
+    // traces open on their process's first turn and close when it ends
+    TraceSet traces;
+    trace_set_init(&traces, filenames, fileCount);
 
+    PageTable *pt = (PageTable *)calloc((size_t)fileCount, sizeof(PageTable));
+    if (!pt) {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
     for (int i = 0; i < fileCount; i++) {
-        if (!fp[i])
-            continue;
-
-        int instructions_seen = 0;
-
-        while (fgets(line1, sizeof(line1), fp[i])) {
-            if (line1[0] == '\n' || line1[0] == '\r' || line1[0] == '\0')
-                continue;
-
-            unsigned long long eip_addr = 0;
-            int eip_len = 0;
-            if (!parse_eip_line(line1, &eip_addr, &eip_len)) {
-                fprintf(stderr, "Warning: invalid EIP line: %s", line1);
-                continue;
-            }
-
-            if (!fgets(line2, sizeof(line2), fp[i])) {
-                break;
-            }
-            if (line2[0] == '\n' || line2[0] == '\r' || line2[0] == '\0') {
-                continue;
-            }
-
-            instructions_seen++;
-            cache.total_instructions++;
-            cache.instruction_bytes += (unsigned long long)eip_len;
-
-            // simple time-slice: stop if over limit 
-            if (instruction_limit != -1 && instructions_seen > instruction_limit) {
-                break;
-            }
+        pt_init(&pt[i]);
+        pt[i].asid = i;
+    }
 
-            // VM: touch instruction pages 
-            unsigned long long first_vpn = eip_addr >> 12;
-            unsigned long long last_vpn =
-                (eip_addr + (unsigned long long)eip_len - 1ULL) >> 12;
-            for (unsigned long long vpn = first_vpn; vpn <= last_vpn; vpn++) {
-                vm_touch_page(&pt[i], vpn,
-                              &page_table_hits,
-                              &pages_from_free,
-                              &total_page_faults,
-                              &virtual_pages_mapped,
-                              &free_ppn_left,
-                              &next_ppn);
-            }
+    CacheSim *caches = (CacheSim *)calloc((size_t)num_caches, sizeof(CacheSim));
+    PhysRecord *batch = (PhysRecord *)malloc(PHYS_BATCH * sizeof(PhysRecord));
+    if (!caches || !batch) {
+        fprintf(stderr, "Error: out of memory.\n");
+        exit(1);
+    }
+    int c = 0;
+    for (int si = 0; si < n_sizes; si++)
+        for (int bi = 0; bi < n_blocks; bi++)
+            for (int ai = 0; ai < n_assocs; ai++)
+                for (int ri = 0; ri < n_policies; ri++)
+                    cache_sim_init(&caches[c++], cache_sizes[si], block_sizes[bi],
+                                   assocs[ai], policies[ri]);
+    for (c = 0; c < num_caches; c++) {
+        cache_sim_seed(&caches[c], seed);
+        cache_sim_write_policy(&caches[c], write_policy, write_allocate);
+    }
+    Prefetcher *prefetchers = NULL;
+    if (prefetch_arg) {
+        prefetchers = (Prefetcher *)calloc((size_t)num_caches, sizeof(Prefetcher));
+        if (!prefetchers) {
+            fprintf(stderr, "Error: out of memory.\n");
+            exit(1);
+        }
+        for (c = 0; c < num_caches; c++)
+            prefetch_init(&prefetchers[c], &prefetch_cfg, &caches[c]);
+    }
+    ShadowCache *shadows = NULL;
+    VictimCache *victims = NULL;
+    if (classify || victim_entries) {
+        shadows = (ShadowCache *)calloc((size_t)num_caches, sizeof(ShadowCache));
+        victims = (VictimCache *)calloc((size_t)num_caches, sizeof(VictimCache));
+        if (!shadows || !victims) {
+            fprintf(stderr, "Error: out of memory.\n");
+            exit(1);
+        }
+    }
+    for (c = 0; c < num_caches; c++) {
+        if (classify) {
+            shadow_init(&shadows[c], (unsigned long long)caches[c].num_blocks);
+            cache_sim_classify(&caches[c], &shadows[c]);
+        }
+        if (victim_entries) {
+            victim_init(&victims[c], victim_entries);
+            cache_sim_victim(&caches[c], &victims[c]);
+        }
+    }
 
-            // parse data line 
-            unsigned long long dst_addr, src_addr;
-            int dst_valid, src_valid;
-            parse_dst_src_line(line2, &dst_addr, &dst_valid,
-                               &src_addr, &src_valid);
-
-            if (dst_valid && dst_addr != 0) {
-                unsigned long long vpn = dst_addr >> 12;
-                vm_touch_page(&pt[i], vpn,
-                              &page_table_hits,
-                              &pages_from_free,
-                              &total_page_faults,
-                              &virtual_pages_mapped,
-                              &free_ppn_left,
-                              &next_ppn);
-            }
+    // stack distances for the first configuration's block size and sets
+    StackDist sd;
+    if (mrc)
+        stackdist_init(&sd, caches[0].block_size, caches[0].num_sets,
+                       8192ULL * 1024ULL / (unsigned long long)caches[0].block_size);
+
+    VmStats vm = {0};
+    vm.free_ppn_left = user_pages;
+    FrameTable frames;
+    if (page_repl != PAGE_REPL_NONE) {
+        frames_init(&frames, page_repl, pt, vm.next_ppn, user_pages, seed);
+        vm.frames = &frames;
+        vm.flush_evicted = flush_evicted;
+    }
+    Tlb tlb;
+    if (tlb_arg[0]) {
+        tlb_init(&tlb, &tlb_cfg[0], tlb_arg[1] ? &tlb_cfg[1] : NULL, tlb_walk);
+        vm.tlb = &tlb;
+    }
 
-            if (src_valid && src_addr != 0) {
-                unsigned long long vpn = src_addr >> 12;
-                vm_touch_page(&pt[i], vpn,
-                              &page_table_hits,
-                              &pages_from_free,
-                              &total_page_faults,
-                              &virtual_pages_mapped,
-                              &free_ppn_left,
-                              &next_ppn);
-            }
+    // translate each batch once, then replay it through every cache,
+    // either inline or on the worker pool. A single cache is instead
+    // split by sets across the threads
+    SweepPool pool;
+    ShardedCache sharded;
+    Hierarchy hier;
+    CacheStage stage = {caches, num_caches, mrc ? &sd : NULL, NULL, NULL, NULL, NULL,
+                        NULL, NULL, -1, 0, switch_cost, flush_cache_on_switch};
+    ProcStats *procs = NULL;
+    if (schedule) {
+        procs = (ProcStats *)calloc((size_t)fileCount, sizeof(ProcStats));
+        if (!procs) {
+            fprintf(stderr, "Error: out of memory.\n");
+            exit(1);
+        }
+        stage.procs = procs;
+        vm.flush_tlb_on_switch = flush_tlb_on_switch;
+    }
+    if (hierarchy) {
+        if (!hier_init(&hier, levels, level_arg[LEVEL_L3] != NULL, inclusion,
+                       mem_latency)) {
+            fprintf(stderr, "Error: The cache hierarchy could not be set up.\n");
+            exit(1);
+        }
+        hier_seed(&hier, seed);
+        stage.hier = &hier;
+    } else if (num_threads > 1 && num_caches > 1) {
+        sweep_pool_start(&pool, caches, num_caches, num_threads);
+        stage.pool = &pool;
+    } else if (num_threads > 1) {
+        shard_cache_start(&sharded, &caches[0], num_threads);
+        stage.sharded = &sharded;
+    }
 
-            // ===== CACHE PART ===== 
+    IntervalSampler sampler;
+    if (interval_out) {
+        interval_start(&sampler, interval_out, interval_unit, interval_every, &vm,
+                       caches, num_caches, hierarchy ? &hier : NULL);
+        stage.sampler = &sampler;
+    }
 
-            // EIP fetch 
-            unsigned long long paddr_eip;
-            if (vm_translate(&pt[i], eip_addr, &paddr_eip)) {
-                cache_access_range(&cache, paddr_eip, eip_len);
+    Pipeline pipe;
+    if (pipelined) {
+        // parse and translate run ahead on their own threads
+        pipeline_start(&pipe, &traces, pt, instruction_limit,
+                       schedule ? instruction_limit : 0, &vm);
+        const PhysBatch *pb;
+        while ((pb = pipeline_next(&pipe)) != NULL) {
+            cache_stage_replay(&stage, pb->recs, pb->n, pb->file);
+            pipeline_release(&pipe, pb);
+        }
+        pipeline_finish(&pipe);
+    } else if (schedule) {
+        // round robin: each live trace runs one -n slice per turn
+        int live = fileCount;
+        for (int i = 0; live > 0; i = (i + 1) % fileCount) {
+            if (!trace_set_live(&traces, i))
+                continue;
+            TraceReader *tr = trace_set_reader(&traces, i);
+            int left = instruction_limit;
+            int done = (tr == NULL);
+            while (left > 0 && !done) {
+                size_t n = vm_translate_slice(tr, &pt[i], &vm, &left, &done, batch,
+                                              cache_stage_batch(&stage));
+                cache_stage_replay(&stage, batch, n, i);
             }
-            cache.total_cycles += 2; // execute instruction 
-
-            // dstM: write 4 bytes 
-            if (dst_valid && dst_addr != 0) {
-                unsigned long long paddr_dst;
-                if (vm_translate(&pt[i], dst_addr, &paddr_dst)) {
-                    cache_access_range(&cache, paddr_dst, 4);
-                }
-                cache.total_cycles += 1; // effective address 
-                cache.srcdst_bytes += 4;
+            if (done) {
+                trace_set_end(&traces, i);
+                live--;
             }
-
-            // srcM: read 4 bytes 
-            if (src_valid && src_addr != 0) {
-                unsigned long long paddr_src;
-                if (vm_translate(&pt[i], src_addr, &paddr_src)) {
-                    cache_access_range(&cache, paddr_src, 4);
-                }
-                cache.total_cycles += 1; // effective address 
-                cache.srcdst_bytes += 4;
+        }
+    } else {
+        for (int i = 0; i < fileCount; i++) {
+            TraceReader *tr = trace_set_reader(&traces, i);
+            int instructions_seen = 0;
+            int done = (tr == NULL);
+            while (!done) {
+                size_t n = vm_translate_batch(tr, &pt[i], &vm, instruction_limit,
+                                              &instructions_seen, &done, batch,
+                                              cache_stage_batch(&stage));
+                cache_stage_replay(&stage, batch, n, i);
             }
+            trace_set_end(&traces, i);
         }
     }
 
-    // add 100 cycles per page fault 
-    cache.total_cycles += 100ULL * total_page_faults;
-
-    for (int i = 0; i < fileCount; i++) {
-        if (fp[i])
-            fclose(fp[i]);
+    cache_stage_flush(&stage);
+    if (stage.sampler) {
+        interval_finish(&sampler);
+        fclose(sampler.out);
     }
+    if (stage.pool)
+        sweep_pool_finish(&pool);
+    if (stage.sharded)
+        shard_cache_finish(&sharded);
+
+    // add 100 cycles per page fault, plus TLB lookups and walks
+    unsigned long long vm_cycles = 100ULL * vm.total_page_faults;
+    if (vm.tlb)
+        vm_cycles += tlb.cycles;
+    for (c = 0; c < num_caches; c++)
+        caches[c].total_cycles += vm_cycles;
+    if (hierarchy)
+        hier.total_cycles += vm_cycles;
+
+    PROFILE_BEGIN(report_start);
+    if (format != FORMAT_TEXT) {
+        Report report;
+        report_init(&report, format, stdout);
+        RunSummary run = {filenames, fileCount, physical_mem, physical_mem_used,
+                          instruction_limit, write_policy, write_allocate, page_repl,
+                          prefetch_arg, victim_entries, schedule, switch_cost,
+                          stage.switches, phys_pages, system_pages, user_pages,
+                          pte_bits, total_pt_bytes, &vm, pt, vm.tlb};
+        report_processes(&report, &run, &traces, (schedule && !sweep) ? procs : NULL);
+        if (hierarchy) {
+            report_begin(&report, "run");
+            report_run_fields(&report, &run);
+            report_hierarchy_fields(&report, &hier);
+            report_end(&report);
+        }
+        for (c = 0; !hierarchy && c < num_caches; c++) {
+            report_begin(&report, "run");
+            report_run_fields(&report, &run);
+            report_cache_fields(&report, &caches[c], physical_mem);
+            report_end(&report);
+        }
+        if (mrc)
+            report_mrc(&report, &sd);
+        if (pipelined)
+            pipeline_report_stats(&pipe, &report);
+        report_free(&report);
+    } else {
+        /* ========== PRINT MILESTONE #2 RESULTS (VM) ========== */
+        printf("\n***** VIRTUAL MEMORY SIMULATION RESULTS *****\n\n");
+        printf("Physical Pages Used By SYSTEM: %llu\n", system_pages);
+        printf("Pages Available to User: %llu\n\n", user_pages);
+
+        printf("Virtual Pages Mapped: %llu\n", vm.virtual_pages_mapped);
+        printf("\t------------------------------\n");
+        printf("\tPage Table Hits: %llu\n", vm.page_table_hits);
+        printf("\tPages from Free: %llu\n", vm.pages_from_free);
+        printf("\tTotal Page Faults: %llu\n", vm.total_page_faults);
+        if (vm.frames)
+            printf("\tPages Evicted: %llu\n", vm.pages_evicted);
+        printf("\n");
+        for (int i = 0; i < fileCount; i++) {
+            unsigned long long used = pt[i].used;
+            double pct = (100.0 * (double)used) / (double)VA_PAGES_PER_PROC;
+            double wasted = ((double)VA_PAGES_PER_PROC - (double)used) *
+                            (double)pte_bits / 8.0;
+
+            printf("[%d] %s:\n", i, filenames[i]);
+            printf("\tUsed Page Table Entries: %llu ( %.2f%% )\n", used, pct);
+            printf("\tPage Table Wasted: %.0f bytes\n", wasted);
+            if (pt_memory)
+                printf("\tPage Table Allocated: %zu bytes\n", pt_bytes(&pt[i]));
+            printf("\n");
+        }
+        if (pt_memory) {
+            // the radix tables' real footprint, next to the flat estimate above
+            size_t pt_total = 0;
+            for (int i = 0; i < fileCount; i++)
+                pt_total += pt_bytes(&pt[i]);
+            printf("Total Page Table Memory Allocated: %zu bytes (%d processes)\n\n",
+                   pt_total, fileCount);
+        }
 
-    /* ========== PRINT MILESTONE #2 RESULTS (VM) ========== */
-    printf("\n***** VIRTUAL MEMORY SIMULATION RESULTS *****\n\n");
-    printf("Physical Pages Used By SYSTEM: %llu\n", system_pages);
-    printf("Pages Available to User: %llu\n\n", user_pages);
-
-    printf("Virtual Pages Mapped: %llu\n", virtual_pages_mapped);
-    printf("\t------------------------------\n");
-    printf("\tPage Table Hits: %llu\n", page_table_hits);
-    printf("\tPages from Free: %llu\n", pages_from_free);
-    printf("\tTotal Page Faults: %llu\n\n", total_page_faults);
-    for (int i = 0; i < fileCount; i++) {
-        unsigned long long used = pt[i].used;
-        double pct = (100.0 * (double)used) / (double)VA_PAGES_PER_PROC;
-        double wasted = ((double)VA_PAGES_PER_PROC - (double)used) *
-                        (double)pte_bits / 8.0;
-
-        printf("[%d] %s:\n", i, filenames[i]);
-        printf("\tUsed Page Table Entries: %llu ( %.2f%% )\n", used, pct);
-        printf("\tPage Table Wasted: %.0f bytes\n\n", wasted);
+        if (vm.tlb)
+            print_tlb_results(&tlb);
+
+        if (schedule && !sweep)
+            print_schedule_results(procs, pt, &traces, &stage);
+
+        // PRINT MILESTONE #3 RESULTS
+        if (hierarchy)
+            print_hierarchy_results(&hier);
+        else if (sweep)
+            print_sweep_results(caches, num_caches, physical_mem);
+        else
+            print_cache_results(&caches[0], &calc);
+        if (mrc)
+            print_mrc_results(&sd);
+        if (pipelined)
+            pipeline_print_stats(&pipe);
+    }
+    PROFILE_END(PROFILE_REPORT, report_start, hierarchy ? 1 : num_caches);
+
+    if (profile && format == FORMAT_TEXT) {
+        profile_print();
+    } else if (profile) {
+        Report report;
+        report_init(&report, format, stdout);
+        profile_report(&report);
+        report_free(&report);
     }
 
-    // PRINT MILESTONE #3 RESULTS  
-    printf(" CACHE SIMULATION RESULTS:\n\n");
-    printf("Total Cache Accesses:\t%llu (%llu addresses)\n",
-           cache.accesses,
-           (unsigned long long)(cache.total_instructions +
-                                (cache.srcdst_bytes / 4)));
-    printf(" Instruction Bytes:\t%llu\n", cache.instruction_bytes);
-    printf(" SrcDst Bytes:\t%llu\n", cache.srcdst_bytes);
-
-    printf("Cache Hits:\t\t%llu\n", cache.hits);
-    printf("Cache Misses:\t\t%llu\n", cache.misses);
-    printf("Compulsory Misses:\t%llu\n", cache.compulsory_misses);
-    printf(" Conflict Misses:\t%llu\n", cache.conflict_misses);
-
-    double hit_rate =
-        (cache.accesses > 0)
-            ? (100.0 * (double)cache.hits / (double)cache.accesses)
-            : 0.0;
-    double miss_rate = 100.0 - hit_rate;
-
-    printf("\nACHE HIT & MISS RATE: \n");
-    printf("Hit  Rate:\t\t%.4f%%\n", hit_rate);
-    printf("Miss Rate:\t\t%.4f%%\n", miss_rate);
-
-    double cpi =
-        (cache.total_instructions > 0)
-            ? ((double)cache.total_cycles /
-               (double)cache.total_instructions)
-            : 0.0;
-    printf("CPI:\t\t\t%.2f Cycles/Instruction (%llu)\n",
-           cpi, cache.total_cycles);
-
-    // unused cache space/blocks 
-    unsigned long long unused_blocks =
-        (cache.num_blocks > cache.compulsory_misses)
-            ? (cache.num_blocks - cache.compulsory_misses)
-            : 0;
-    double overhead_per_block =
-        (cache.num_blocks > 0)
-            ? ((double)total_overhead / (double)cache.num_blocks)
-            : 0.0;
-    double unused_kb =
-        ((double)unused_blocks *
-         ((double)block_size + overhead_per_block)) / 1024.0;
-    double waste = unused_kb * 0.07;
-
-    printf("Unused Cache Space:\t%.2f KB / %.2f KB = %.2f%%  Waste: $%.2f/chip\n",
-           unused_kb,
-           implementation_memory_kb,
-           (implementation_memory_kb > 0.0)
-               ? (100.0 * unused_kb / implementation_memory_kb)
-               : 0.0,
-           waste);
-    printf("Unused Cache Blocks:\t%llu / %d\n",
-           unused_blocks, cache.num_blocks);
-
-    // cleanup 
+    // cleanup
+    if (mrc)
+        stackdist_free(&sd);
     for (int i = 0; i < fileCount; i++) {
         pt_free(&pt[i]);
     }
-    cache_sim_free(&cache);
+    free(pt);
+    free(procs);
+    trace_set_free(&traces);
+    free(filenames);
+    for (c = 0; c < num_caches; c++)
+        cache_sim_free(&caches[c]);
+    free(caches);
+    if (prefetchers) {
+        for (c = 0; c < num_caches; c++)
+            prefetch_free(&prefetchers[c]);
+        free(prefetchers);
+    }
+    for (c = 0; c < num_caches; c++) {
+        if (classify)
+            shadow_free(&shadows[c]);
+        if (victim_entries)
+            victim_free(&victims[c]);
+    }
+    free(shadows);
+    free(victims);
+    free(batch);
+    if (hierarchy)
+        hier_free(&hier);
+    if (vm.tlb)
+        tlb_free(&tlb);
+    if (vm.frames)
+        frames_free(&frames);
 
     return 0;
 }
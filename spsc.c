@@ -0,0 +1,83 @@
+#include "spsc.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void spsc_init(SpscRing *ring, size_t capacity, size_t elem_size) {
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->mask = cap - 1;
+    ring->elem_size = elem_size;
+    ring->buf = (unsigned char *)malloc(cap * elem_size);
+    if (!ring->buf) {
+        fprintf(stderr, "Error: spsc_init out of memory.\n");
+        exit(1);
+    }
+}
+
+void spsc_free(SpscRing *ring) {
+    free(ring->buf);
+    ring->buf = NULL;
+}
+
+// copy n elements between the ring (starting at slot pos) and flat memory
+static void spsc_copy(SpscRing *ring, size_t pos, void *flat, size_t n, int into_ring) {
+    size_t cap = ring->mask + 1;
+    size_t at = pos & ring->mask;
+    size_t first = (n < cap - at) ? n : cap - at;
+    unsigned char *slot = ring->buf + at * ring->elem_size;
+    unsigned char *mem = (unsigned char *)flat;
+    if (into_ring) {
+        memcpy(slot, mem, first * ring->elem_size);
+        memcpy(ring->buf, mem + first * ring->elem_size, (n - first) * ring->elem_size);
+    } else {
+        memcpy(mem, slot, first * ring->elem_size);
+        memcpy(mem + first * ring->elem_size, ring->buf, (n - first) * ring->elem_size);
+    }
+}
+
+size_t spsc_push(SpscRing *ring, const void *elems, size_t n) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t space = ring->mask + 1 - (tail - head);
+    if (n > space) n = space;
+    if (n == 0) return 0;
+    spsc_copy(ring, tail, (void *)elems, n, 1);
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    return n;
+}
+
+size_t spsc_pop(SpscRing *ring, void *out, size_t max) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t n = tail - head;
+    if (n > max) n = max;
+    if (n == 0) return 0;
+    spsc_copy(ring, head, out, n, 0);
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+    return n;
+}
+
+void spsc_push_all(SpscRing *ring, const void *elems, size_t n) {
+    const unsigned char *p = (const unsigned char *)elems;
+    while (n > 0) {
+        size_t done = spsc_push(ring, p, n);
+        if (done == 0) {
+            sched_yield();
+            continue;
+        }
+        p += done * ring->elem_size;
+        n -= done;
+    }
+}
+
+size_t spsc_pop_wait(SpscRing *ring, void *out, size_t max) {
+    size_t n;
+    while ((n = spsc_pop(ring, out, max)) == 0)
+        sched_yield();
+    return n;
+}
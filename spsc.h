@@ -0,0 +1,38 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+// LOCK-FREE SINGLE-PRODUCER / SINGLE-CONSUMER RING
+//
+// Fixed-size elements, power-of-two capacity. The producer only writes
+// tail and the consumer only writes head, each on its own host cache line.
+// Both sides move elements in batches to amortize the atomics.
+
+#define SPSC_LINE 64
+
+typedef struct {
+    _Atomic size_t head;                     // next slot to pop
+    char pad0[SPSC_LINE - sizeof(size_t)];
+    _Atomic size_t tail;                     // next slot to push
+    char pad1[SPSC_LINE - sizeof(size_t)];
+    size_t mask;                             // capacity - 1
+    size_t elem_size;
+    unsigned char *buf;
+} SpscRing;
+
+// capacity is rounded up to a power of two
+void spsc_init(SpscRing *ring, size_t capacity, size_t elem_size);
+void spsc_free(SpscRing *ring);
+
+// Copy up to n elements in / out. Return how many were moved, never block
+size_t spsc_push(SpscRing *ring, const void *elems, size_t n);
+size_t spsc_pop(SpscRing *ring, void *out, size_t max);
+
+// Blocking push: yields the CPU until all n elements are in
+void spsc_push_all(SpscRing *ring, const void *elems, size_t n);
+// Blocking pop: yields the CPU until at least one element is out
+size_t spsc_pop_wait(SpscRing *ring, void *out, size_t max);
+
+#endif
@@ -0,0 +1,192 @@
+#include "stackdist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *sd_alloc(size_t n, size_t size) {
+    void *p = calloc(n, size);
+    if (!p) {
+        fprintf(stderr, "Error: stackdist out of memory.\n");
+        exit(1);
+    }
+    return p;
+}
+
+void stackdist_init(StackDist *sd, int block_size, int num_sets,
+                    unsigned long long max_blocks) {
+    memset(sd, 0, sizeof(*sd));
+    sd->block_size = block_size;
+    sd->num_sets = num_sets;
+    sd->max_blocks = max_blocks;
+
+    sd->table_cap = 1024;
+    sd->keys = (unsigned long long *)sd_alloc(sd->table_cap, sizeof(unsigned long long));
+    sd->last = (unsigned long long *)sd_alloc(sd->table_cap, sizeof(unsigned long long));
+
+    sd->bit_cap = 1ULL << 16;
+    sd->bit = (uint32_t *)sd_alloc((size_t)sd->bit_cap + 1, sizeof(uint32_t));
+
+    sd->hist = (unsigned long long *)sd_alloc((size_t)max_blocks, sizeof(unsigned long long));
+    sd->set_stack = (unsigned long long *)sd_alloc((size_t)num_sets * SD_MAX_WAYS,
+                                                   sizeof(unsigned long long));
+}
+
+void stackdist_free(StackDist *sd) {
+    free(sd->keys);
+    free(sd->last);
+    free(sd->bit);
+    free(sd->hist);
+    free(sd->set_stack);
+    memset(sd, 0, sizeof(*sd));
+}
+
+// FENWICK TREE (1-based over access times)
+
+static void bit_add(StackDist *sd, unsigned long long i, int delta) {
+    for (; i <= sd->bit_cap; i += i & (~i + 1))
+        sd->bit[i] += (uint32_t)delta;
+}
+
+static unsigned long long bit_sum(const StackDist *sd, unsigned long long i) {
+    unsigned long long s = 0;
+    for (; i > 0; i -= i & (~i + 1))
+        s += sd->bit[i];
+    return s;
+}
+
+// BLOCK -> LAST ACCESS TIME TABLE
+
+static size_t sd_slot(const StackDist *sd, unsigned long long key) {
+    size_t mask = sd->table_cap - 1;
+    size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 20) & mask;
+    while (sd->keys[i] != 0 && sd->keys[i] != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+static void sd_grow_table(StackDist *sd) {
+    unsigned long long *old_keys = sd->keys, *old_last = sd->last;
+    size_t old_cap = sd->table_cap;
+    sd->table_cap *= 2;
+    sd->keys = (unsigned long long *)sd_alloc(sd->table_cap, sizeof(unsigned long long));
+    sd->last = (unsigned long long *)sd_alloc(sd->table_cap, sizeof(unsigned long long));
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old_keys[i]) {
+            size_t j = sd_slot(sd, old_keys[i]);
+            sd->keys[j] = old_keys[i];
+            sd->last[j] = old_last[i];
+        }
+    }
+    free(old_keys);
+    free(old_last);
+}
+
+static int cmp_time(const void *a, const void *b) {
+    unsigned long long x = **(unsigned long long *const *)a;
+    unsigned long long y = **(unsigned long long *const *)b;
+    return (x > y) - (x < y);
+}
+
+// Out of time stamps: renumber the live last-access times 1..D in order
+// (distances only depend on their order) and rebuild the tree
+static void sd_compact(StackDist *sd) {
+    unsigned long long **live =
+        (unsigned long long **)sd_alloc(sd->table_used + 1, sizeof(*live));
+    size_t d = 0;
+    for (size_t i = 0; i < sd->table_cap; i++) {
+        if (sd->keys[i]) live[d++] = &sd->last[i];
+    }
+    qsort(live, d, sizeof(*live), cmp_time);
+
+    while (sd->bit_cap < 4ULL * d)
+        sd->bit_cap *= 2;
+    free(sd->bit);
+    sd->bit = (uint32_t *)sd_alloc((size_t)sd->bit_cap + 1, sizeof(uint32_t));
+    for (size_t k = 0; k < d; k++) {
+        *live[k] = k + 1;
+        bit_add(sd, k + 1, 1);
+    }
+    sd->now = d;
+    free(live);
+}
+
+// One access for ONE block
+void stackdist_access_block(StackDist *sd, unsigned long long phys_addr) {
+    unsigned long long block = phys_addr / (unsigned long long)sd->block_size;
+    unsigned long long key = block + 1;
+    sd->accesses++;
+
+    // global distance
+    if (sd->now == sd->bit_cap)
+        sd_compact(sd);
+    unsigned long long t = ++sd->now;
+
+    size_t i = sd_slot(sd, key);
+    if (sd->keys[i]) {
+        unsigned long long prev = sd->last[i];
+        unsigned long long dist = bit_sum(sd, t - 1) - bit_sum(sd, prev);
+        if (dist < sd->max_blocks) sd->hist[dist]++;
+        else sd->far++;
+        bit_add(sd, prev, -1);
+    } else {
+        sd->cold++;
+        sd->keys[i] = key;
+        sd->table_used++;
+    }
+    sd->last[i] = t;
+    bit_add(sd, t, 1);
+    if (sd->table_used * 10 > sd->table_cap * 7)
+        sd_grow_table(sd);
+
+    // per-set distance, move to front
+    unsigned long long *stack =
+        &sd->set_stack[(size_t)(block % (unsigned long long)sd->num_sets) * SD_MAX_WAYS];
+    int pos = 0;
+    while (pos < SD_MAX_WAYS && stack[pos] != key)
+        pos++;
+    if (pos < SD_MAX_WAYS) sd->set_hist[pos]++;
+    else sd->set_far++;
+    if (pos == SD_MAX_WAYS) pos = SD_MAX_WAYS - 1;
+    memmove(stack + 1, stack, (size_t)pos * sizeof(*stack));
+    stack[0] = key;
+}
+
+static void stackdist_access_range(StackDist *sd, unsigned long long phys_addr, int len) {
+    unsigned long long bs = (unsigned long long)sd->block_size;
+    unsigned long long first_block = phys_addr / bs;
+    unsigned long long last_block = (phys_addr + (unsigned long long)len - 1ULL) / bs;
+    for (unsigned long long b = first_block; b <= last_block; b++)
+        stackdist_access_block(sd, b * bs);
+}
+
+// Same block stream as cache_sim_replay() sends to cache_access_block()
+void stackdist_replay(StackDist *sd, const PhysRecord *recs, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const PhysRecord *r = &recs[i];
+        if (r->flags & (PHYS_COUNT_ONLY | PHYS_FLUSH_PAGE))
+            continue;
+        if (r->flags & PHYS_EIP_MAPPED)
+            stackdist_access_range(sd, r->eip_pa, r->len);
+        if ((r->flags & PHYS_DST_USED) && (r->flags & PHYS_DST_MAPPED))
+            stackdist_access_range(sd, r->dst_pa, 4);
+        if ((r->flags & PHYS_SRC_USED) && (r->flags & PHYS_SRC_MAPPED))
+            stackdist_access_range(sd, r->src_pa, 4);
+    }
+}
+
+double stackdist_miss_ratio(const StackDist *sd, unsigned long long blocks) {
+    if (sd->accesses == 0) return 0.0;
+    unsigned long long misses = sd->cold + sd->far;
+    for (unsigned long long d = blocks; d < sd->max_blocks; d++)
+        misses += sd->hist[d];
+    return (double)misses / (double)sd->accesses;
+}
+
+double stackdist_set_miss_ratio(const StackDist *sd, int ways) {
+    if (sd->accesses == 0) return 0.0;
+    unsigned long long misses = sd->set_far;
+    for (int p = ways; p < SD_MAX_WAYS; p++)
+        misses += sd->set_hist[p];
+    return (double)misses / (double)sd->accesses;
+}
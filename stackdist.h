@@ -0,0 +1,61 @@
+#ifndef STACKDIST_H
+#define STACKDIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cachesim.h"
+
+// LRU STACK DISTANCE (Mattson) over the physical block stream
+//
+// Global: distance = number of distinct blocks touched since the last
+// access to the same block, counted with a Fenwick tree over access
+// times. A fully associative LRU cache of K blocks hits iff distance < K,
+// so one pass gives the miss ratio of every cache size.
+//
+// Per set: for a fixed number of sets, a depth-SD_MAX_WAYS LRU stack per
+// set gives the miss ratio of every associativity up to SD_MAX_WAYS.
+
+#define SD_MAX_WAYS 16
+
+typedef struct {
+    int block_size;
+    int num_sets;                 // per-set analysis
+    unsigned long long max_blocks;  // histogram depth (largest cache)
+
+    // block -> last access time, open addressing
+    unsigned long long *keys;     // block number + 1, 0 = empty
+    unsigned long long *last;
+    size_t table_cap;
+    size_t table_used;
+
+    // Fenwick tree over times: 1 where a block was last touched
+    uint32_t *bit;
+    unsigned long long bit_cap;
+    unsigned long long now;
+
+    // global histogram: hist[d] accesses at distance d, deeper ones in far
+    unsigned long long *hist;
+    unsigned long long far;
+    unsigned long long cold;
+    unsigned long long accesses;
+
+    // per-set LRU stacks [num_sets * SD_MAX_WAYS], block number + 1
+    unsigned long long *set_stack;
+    unsigned long long set_hist[SD_MAX_WAYS];
+    unsigned long long set_far;   // deeper than SD_MAX_WAYS or cold
+} StackDist;
+
+void stackdist_init(StackDist *sd, int block_size, int num_sets,
+                    unsigned long long max_blocks);
+void stackdist_free(StackDist *sd);
+
+void stackdist_access_block(StackDist *sd, unsigned long long phys_addr);
+void stackdist_replay(StackDist *sd, const PhysRecord *recs, size_t n);
+
+// Miss ratio (0..1) of a fully associative LRU cache of `blocks` blocks
+double stackdist_miss_ratio(const StackDist *sd, unsigned long long blocks);
+// Miss ratio of a num_sets x ways LRU cache
+double stackdist_set_miss_ratio(const StackDist *sd, int ways);
+
+#endif
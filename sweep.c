@@ -0,0 +1,114 @@
+#include "sweep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Hand a worker the chunk after prev (the first chunk if prev is NULL) and
+// release prev. Returns NULL once the list is closed and drained
+static SweepChunk *sweep_next_chunk(SweepPool *pool, SweepChunk *prev) {
+    pthread_mutex_lock(&pool->lock);
+    SweepChunk *next;
+    for (;;) {
+        next = prev ? prev->next : pool->head;
+        if (next || pool->closed) break;
+        pthread_cond_wait(&pool->published, &pool->lock);
+    }
+
+    // every worker walks the list in order, so chunks drain oldest first
+    if (prev && --prev->pending == 0) {
+        pool->head = prev->next;
+        if (!pool->head) pool->tail = NULL;
+        pool->live_chunks--;
+        free(prev);
+        pthread_cond_signal(&pool->released);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return next;
+}
+
+static void *sweep_worker_main(void *arg) {
+    SweepWorker *w = (SweepWorker *)arg;
+    SweepPool *pool = w->pool;
+
+    SweepChunk *chunk = NULL;
+    while ((chunk = sweep_next_chunk(pool, chunk)) != NULL) {
+        for (int c = w->id; c < pool->num_caches; c += pool->num_workers)
+            cache_sim_replay(&pool->caches[c], chunk->recs, chunk->n);
+    }
+    return NULL;
+}
+
+void sweep_pool_start(SweepPool *pool, CacheSim *caches, int num_caches,
+                      int num_workers) {
+    if (num_workers > num_caches) num_workers = num_caches;
+    if (num_workers < 1) num_workers = 1;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->published, NULL);
+    pthread_cond_init(&pool->released, NULL);
+    pool->head = pool->tail = NULL;
+    pool->live_chunks = 0;
+    pool->closed = 0;
+    pool->caches = caches;
+    pool->num_caches = num_caches;
+    pool->num_workers = num_workers;
+
+    pool->workers = (SweepWorker *)calloc((size_t)num_workers, sizeof(SweepWorker));
+    if (!pool->workers) {
+        fprintf(stderr, "Error: sweep_pool_start out of memory.\n");
+        exit(1);
+    }
+    for (int w = 0; w < num_workers; w++) {
+        pool->workers[w].pool = pool;
+        pool->workers[w].id = w;
+        if (pthread_create(&pool->workers[w].thread, NULL, sweep_worker_main,
+                           &pool->workers[w]) != 0) {
+            fprintf(stderr, "Error: cannot create sweep worker thread.\n");
+            exit(1);
+        }
+    }
+}
+
+SweepChunk *sweep_pool_chunk(SweepPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->live_chunks >= SWEEP_MAX_CHUNKS)
+        pthread_cond_wait(&pool->released, &pool->lock);
+    pool->live_chunks++;
+    pthread_mutex_unlock(&pool->lock);
+
+    SweepChunk *chunk = (SweepChunk *)malloc(sizeof(SweepChunk));
+    if (!chunk) {
+        fprintf(stderr, "Error: sweep_pool_chunk out of memory.\n");
+        exit(1);
+    }
+    chunk->n = 0;
+    chunk->next = NULL;
+    return chunk;
+}
+
+void sweep_pool_publish(SweepPool *pool, SweepChunk *chunk, size_t n) {
+    chunk->n = n;
+    chunk->pending = pool->num_workers;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) pool->tail->next = chunk;
+    else pool->head = chunk;
+    pool->tail = chunk;
+    pthread_cond_broadcast(&pool->published);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void sweep_pool_finish(SweepPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->closed = 1;
+    pthread_cond_broadcast(&pool->published);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int w = 0; w < pool->num_workers; w++)
+        pthread_join(pool->workers[w].thread, NULL);
+    free(pool->workers);
+    pool->workers = NULL;
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->published);
+    pthread_cond_destroy(&pool->released);
+}
@@ -0,0 +1,63 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "cachesim.h"
+
+// THREAD-PARALLEL SWEEP
+//
+// The main thread translates the trace once into a shared list of
+// read-only chunks. Each worker owns a fixed subset of the caches and
+// walks the chunk list at its own pace. A chunk is freed by the last
+// worker to finish it, and the producer waits once SWEEP_MAX_CHUNKS are in
+// flight, so memory stays bounded on long traces.
+
+#define SWEEP_CHUNK 16384        // PhysRecords per chunk
+#define SWEEP_MAX_CHUNKS 64      // chunks in flight before the producer waits
+
+typedef struct SweepChunk {
+    PhysRecord recs[SWEEP_CHUNK];
+    size_t n;
+    int pending;                 // workers that have not finished it
+    struct SweepChunk *next;
+} SweepChunk;
+
+typedef struct SweepPool SweepPool;
+
+typedef struct {
+    SweepPool *pool;
+    int id;
+    pthread_t thread;
+} SweepWorker;
+
+struct SweepPool {
+    pthread_mutex_t lock;
+    pthread_cond_t published;    // new chunk or closed
+    pthread_cond_t released;     // a chunk was freed
+
+    SweepChunk *head;            // oldest chunk still in use
+    SweepChunk *tail;            // newest published chunk
+    int live_chunks;
+    int closed;
+
+    CacheSim *caches;
+    int num_caches;
+    SweepWorker *workers;
+    int num_workers;
+};
+
+// Start num_workers threads replaying into caches[0..num_caches)
+void sweep_pool_start(SweepPool *pool, CacheSim *caches, int num_caches,
+                      int num_workers);
+
+// Producer side: get an empty chunk, fill up to SWEEP_CHUNK records,
+// then publish it with its record count
+SweepChunk *sweep_pool_chunk(SweepPool *pool);
+void sweep_pool_publish(SweepPool *pool, SweepChunk *chunk, size_t n);
+
+// No more chunks: wait for the workers to drain the list and join them
+void sweep_pool_finish(SweepPool *pool);
+
+#endif
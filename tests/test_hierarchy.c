@@ -0,0 +1,188 @@
+// Inclusion invariants of the cache hierarchy, checked after every
+// instruction of a random stream whose code and data regions overlap:
+//
+//   inclusive      every block in L1I/L1D is inside a block of L2 (and of
+//                  L3), every L2 block inside one of L3
+//   exclusive      no block is held by two levels (L1I and L1D are one
+//                  level and may share a block)
+//   non-inclusive  never back-invalidates, and does leave L1 blocks that
+//                  L2 has dropped
+//
+// and, for exclusive, that a block fetched as an instruction and then
+// loaded as data comes across from L1I instead of from memory.
+//
+// Small caches keep the evictions frequent; inclusive/NINE use larger
+// blocks further down to exercise the partial-overlap paths.
+//
+// usage: test_hierarchy   (exit status 0 = pass)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hierarchy.h"
+
+#define INSTRUCTIONS 20000
+
+static int failures = 0;
+
+static void fail(const char* mode, const char* what, int i) {
+    printf("FAIL %s: %s at instruction %d\n", mode, what, i);
+    failures++;
+}
+
+// Address of every valid block of cs to fn; stops at the first nonzero
+// return and passes it on
+static int each_block(const CacheSim* cs, const Hierarchy* h, int upper,
+                      int (*fn)(const Hierarchy* h, int upper, unsigned long long addr)) {
+    for (int s = 0; s < cs->num_sets; s++) {
+        for (int w = 0; w < cs->associativity; w++) {
+            if (!(cs->sets[s].valid >> w & 1U))
+                continue;
+            unsigned long long block =
+                (unsigned long long)cs->tags[(size_t)s * (size_t)cs->associativity +
+                                             (size_t)w] *
+                    (unsigned long long)cs->num_sets + (unsigned long long)s;
+            int r = fn(h, upper, block * (unsigned long long)cs->block_size);
+            if (r)
+                return r;
+        }
+    }
+    return 0;
+}
+
+// Level holding the block at addr below level upper but not in it: 0 if
+// every lower level holds it (inclusive check)
+static int missing_below(const Hierarchy* h, int upper, unsigned long long addr) {
+    for (int l = (upper < LEVEL_L2 ? LEVEL_L2 : upper + 1); l < h->num_levels; l++)
+        if (!cache_holds(&h->cache[l], addr))
+            return l;
+    return 0;
+}
+
+// A lower level that also holds the block (exclusive check), 0 if none
+static int also_below(const Hierarchy* h, int upper, unsigned long long addr) {
+    for (int l = (upper < LEVEL_L2 ? LEVEL_L2 : upper + 1); l < h->num_levels; l++)
+        if (cache_holds(&h->cache[l], addr))
+            return l;
+    return 0;
+}
+
+static int check_levels(const Hierarchy* h,
+                        int (*fn)(const Hierarchy* h, int upper, unsigned long long addr)) {
+    for (int l = 0; l < h->num_levels - 1; l++)
+        if (each_block(&h->cache[l], h, l, fn))
+            return 1;
+    return 0;
+}
+
+static void run(InclusionMode mode, int has_l3) {
+    LevelConfig cfg[LEVEL_COUNT] = {
+        {1, 16, 2, POLICY_LRU, 1},
+        {1, 16, 2, POLICY_LRU, 1},
+        {2, 32, 4, POLICY_LRU, 10},
+        {4, 64, 4, POLICY_LRU, 30},
+    };
+    if (mode == INCLUSION_EXCLUSIVE) {
+        cfg[LEVEL_L2].block_size = 16;
+        cfg[LEVEL_L3].block_size = 16;
+    }
+    Hierarchy h;
+    char name[32];
+    snprintf(name, sizeof(name), "%s%s", inclusion_mode_name(mode), has_l3 ? "+L3" : "");
+    if (!hier_init(&h, cfg, has_l3, mode, 100)) {
+        fail(name, "hier_init rejected the configuration", 0);
+        return;
+    }
+
+    // code in [0, 24K), data in [16K, 40K): some blocks are both
+    unsigned long long x = 777;
+    int not_inclusive = 0;
+    for (int i = 0; i < INSTRUCTIONS; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        PhysRecord r;
+        memset(&r, 0, sizeof(r));
+        r.eip_pa = (uint32_t)((x >> 33) % (24 * 1024));
+        r.len = (uint8_t)(1 + (x >> 20) % 8);
+        r.dst_pa = (uint32_t)(16 * 1024 + (x >> 40) % (24 * 1024));
+        r.src_pa = (uint32_t)(16 * 1024 + (x >> 8) % (24 * 1024));
+        r.flags = PHYS_EIP_MAPPED | PHYS_DST_USED | PHYS_DST_MAPPED;
+        if (x & 1)
+            r.flags |= PHYS_SRC_USED | PHYS_SRC_MAPPED;
+        hier_replay(&h, &r, 1);
+
+        // a broken invariant stays broken: report the first instruction
+        if (mode == INCLUSION_INCLUSIVE && check_levels(&h, missing_below)) {
+            fail(name, "an upper-level block is missing below", i);
+            break;
+        }
+        if (mode == INCLUSION_EXCLUSIVE && check_levels(&h, also_below)) {
+            fail(name, "a block is held by two levels", i);
+            break;
+        }
+        if (mode == INCLUSION_NINE && !not_inclusive)
+            not_inclusive = each_block(&h.cache[LEVEL_L1I], &h, LEVEL_L1I, missing_below) ||
+                            each_block(&h.cache[LEVEL_L1D], &h, LEVEL_L1D, missing_below);
+    }
+    if (mode == INCLUSION_NINE) {
+        if (h.back_invalidations != 0)
+            fail(name, "back-invalidated", INSTRUCTIONS);
+        if (!not_inclusive)
+            fail(name, "L1 never kept a block L2 dropped", INSTRUCTIONS);
+    } else if (mode == INCLUSION_INCLUSIVE && h.back_invalidations == 0) {
+        fail(name, "no back-invalidation happened", INSTRUCTIONS);
+    }
+    hier_free(&h);
+}
+
+// Fetch one block as code, then load it as data, in an exclusive hierarchy
+static void sibling(int has_l3) {
+    LevelConfig cfg[LEVEL_COUNT] = {
+        {1, 16, 2, POLICY_LRU, 1},
+        {1, 16, 2, POLICY_LRU, 1},
+        {2, 16, 4, POLICY_LRU, 10},
+        {4, 16, 4, POLICY_LRU, 30},
+    };
+    const char* name = has_l3 ? "Exclusive+L3 L1I->L1D" : "Exclusive L1I->L1D";
+    Hierarchy h;
+    if (!hier_init(&h, cfg, has_l3, INCLUSION_EXCLUSIVE, 100)) {
+        fail(name, "hier_init rejected the configuration", 0);
+        return;
+    }
+
+    PhysRecord r[2];
+    memset(r, 0, sizeof(r));
+    r[0].eip_pa = 0x1000;
+    r[0].len = 4;
+    r[0].flags = PHYS_EIP_MAPPED;
+    r[1].eip_pa = 0x2000;
+    r[1].len = 4;
+    r[1].dst_pa = 0x1000;
+    r[1].flags = PHYS_EIP_MAPPED | PHYS_DST_USED | PHYS_DST_MAPPED;
+    hier_replay(&h, r, 2);
+
+    // two fetches from memory, each through every level, two executes;
+    // the load pays L1D, the L2-latency transfer and its address
+    unsigned long long miss = 1 + 10 + (has_l3 ? 30 : 0) + 100;
+    if (h.mem_accesses != 2)
+        fail(name, "the load went to memory", 1);
+    if (h.sibling_transfers != 1)
+        fail(name, "no L1I to L1D transfer", 1);
+    if (!cache_holds(&h.cache[LEVEL_L1I], 0x1000) ||
+        !cache_holds(&h.cache[LEVEL_L1D], 0x1000) ||
+        cache_holds(&h.cache[LEVEL_L2], 0x1000))
+        fail(name, "the block is not in exactly L1I and L1D", 1);
+    if (h.total_cycles != 2 * (miss + 2) + 1 + 10 + 1)
+        fail(name, "the load was not charged an L2 lookup", 1);
+    hier_free(&h);
+}
+
+int main(void) {
+    InclusionMode modes[] = {INCLUSION_NINE, INCLUSION_INCLUSIVE, INCLUSION_EXCLUSIVE};
+    for (int m = 0; m < 3; m++)
+        for (int l3 = 0; l3 < 2; l3++)
+            run(modes[m], l3);
+    sibling(0);
+    sibling(1);
+    printf("%s test_hierarchy\n", failures ? "FAIL" : "ok  ");
+    return failures != 0;
+}
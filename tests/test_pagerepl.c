@@ -0,0 +1,80 @@
+// Page replacement under pressure: with 3 frames and instructions whose
+// EIP, dstM and srcM sit on three different pages, a fault on one operand
+// must never evict the frame an earlier touch of the same instruction got.
+// Every used access has to come out mapped, for every policy.
+//
+// usage: test_pagerepl   (exit status 0 = pass)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipeline.h"
+
+#define FRAMES 3
+#define INSTRUCTIONS 20000
+
+static int failures = 0;
+
+static void check(int ok, const char* what, PageReplacement policy, int i) {
+    if (!ok) {
+        if (failures < 10)
+            printf("FAIL %s: %s at instruction %d\n", page_repl_name(policy), what, i);
+        failures++;
+    }
+}
+
+static void run(PageReplacement policy) {
+    PageTable pt;
+    pt_init(&pt);
+    pt.asid = 0;
+
+    VmStats vm;
+    memset(&vm, 0, sizeof(vm));
+    vm.free_ppn_left = FRAMES;
+    vm.next_ppn = 100;
+    FrameTable frames;
+    frames_init(&frames, policy, &pt, vm.next_ppn, FRAMES, 7);
+    vm.frames = &frames;
+
+    // a small working set of 8 pages, so pages come back after eviction
+    unsigned long long x = 12345;
+    for (int i = 0; i < INSTRUCTIONS; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        unsigned long long eip_page = 1 + (x >> 40) % 8;
+        unsigned long long dst_page = 1 + (eip_page + (x >> 20) % 7) % 8;
+        unsigned long long src_page = 1 + (x >> 50) % 8;
+        if (src_page == eip_page || src_page == dst_page)
+            src_page = 0;  // two-page instruction
+
+        TraceRecord rec = {0};
+        rec.eip = (eip_page << 12) | 0x10;
+        rec.len = 4;
+        rec.dst = (dst_page << 12) | 0x20;
+        rec.dst_valid = 1;
+        rec.src = src_page ? ((src_page << 12) | 0x30) : 0;
+        rec.src_valid = src_page != 0;
+
+        PhysRecord out[VM_MAX_RECORDS];
+        size_t n = vm_translate_record(&pt, &vm, &rec, out);
+        const PhysRecord* r = &out[n - 1];
+        check(r->flags & PHYS_EIP_MAPPED, "EIP access lost", policy, i);
+        check(r->flags & PHYS_DST_MAPPED, "dstM access lost", policy, i);
+        if (src_page)
+            check(r->flags & PHYS_SRC_MAPPED, "srcM access lost", policy, i);
+        check((r->eip_pa >> 12) != (r->dst_pa >> 12), "EIP and dstM share a frame",
+              policy, i);
+    }
+    check(vm.pages_evicted > 0, "no page was ever evicted", policy, INSTRUCTIONS);
+
+    frames_free(&frames);
+    pt_free(&pt);
+}
+
+int main(void) {
+    PageReplacement policies[] = {PAGE_REPL_FIFO, PAGE_REPL_CLOCK, PAGE_REPL_LRU,
+                                  PAGE_REPL_RANDOM};
+    for (int p = 0; p < 4; p++)
+        run(policies[p]);
+    printf("%s test_pagerepl\n", failures ? "FAIL" : "ok  ");
+    return failures != 0;
+}
@@ -0,0 +1,112 @@
+// RRIP insertion policies: hand-traced hit counts for SRRIP on one set of
+// a 4-way cache, scan resistance of all three, BRRIP keeping most of a
+// loop that thrashes SRRIP and LRU, and DRRIP's duel: leader sets move
+// psel on their misses and the followers switch with it.
+//
+// usage: test_rrip   (exit status 0 = pass)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cachesim.h"
+
+#define WAYS 4
+#define BLOCK 16
+
+static int failures = 0;
+
+static void check(int ok, const char* what, ReplacementPolicy policy) {
+    if (!ok) {
+        printf("FAIL %s: %s\n", cache_policy_name(policy), what);
+        failures++;
+    }
+}
+
+// Block n (n >= 1) of set s
+static unsigned long long block_addr(const CacheSim* cs, int s, int n) {
+    return ((unsigned long long)n * (unsigned long long)cs->num_sets +
+            (unsigned long long)s) * BLOCK;
+}
+
+// Run seq (one letter per block) through set s, return the hits it made
+static unsigned long long run_seq(CacheSim* cs, int s, const char* seq, int rounds) {
+    unsigned long long hits = cs->hits;
+    for (int r = 0; r < rounds; r++)
+        for (const char* p = seq; *p; p++)
+            cache_access_block(cs, block_addr(cs, s, *p - 'A' + 1));
+    return cs->hits - hits;
+}
+
+static unsigned long long hits_of(ReplacementPolicy policy, const char* seq, int rounds) {
+    CacheSim cs;
+    cache_sim_init(&cs, 1, BLOCK, WAYS, policy);
+    unsigned long long hits = run_seq(&cs, 0, seq, rounds);
+    cache_sim_free(&cs);
+    return hits;
+}
+
+static void expect(ReplacementPolicy policy, const char* seq, unsigned long long hits) {
+    unsigned long long got = hits_of(policy, seq, 1);
+    if (got != hits) {
+        printf("FAIL %s: %llu hits on %s, expected %llu\n", cache_policy_name(policy),
+               got, seq, hits);
+        failures++;
+    }
+}
+
+int main(void) {
+    ReplacementPolicy rrip[] = {POLICY_SRRIP, POLICY_BRRIP, POLICY_DRRIP};
+
+    // SRRIP inserts at 2 and hits go to 0: E ages everyone and takes B,
+    // the next fills take the blocks still at 3
+    expect(POLICY_SRRIP, "ABCDABCDABCD", 8);
+    expect(POLICY_SRRIP, "ABCDAEABCD", 2);
+    expect(POLICY_SRRIP, "ABCDEABCDEABCDE", 0);
+
+    // a reused pair survives a scan of new blocks, whatever BRRIP draws;
+    // LRU loses it
+    for (int p = 0; p < 3; p++)
+        expect(rrip[p], "ABABCDEFAB", 4);
+    expect(POLICY_LRU, "ABABCDEFAB", 2);
+
+    // a loop one block larger than the set: BRRIP fills at distant
+    // re-reference, so one way thrashes and three keep hitting
+    unsigned long long loop = 5 * 100;
+    check(hits_of(POLICY_SRRIP, "ABCDE", 100) == 0, "SRRIP hit on a thrashing loop",
+          POLICY_SRRIP);
+    check(hits_of(POLICY_BRRIP, "ABCDE", 100) >= loop / 2, "BRRIP thrashed on a loop",
+          POLICY_BRRIP);
+
+    // DRRIP in a 1 KB cache: every set leads, even ones SRRIP, odd BRRIP
+    CacheSim cs;
+    cache_sim_init(&cs, 1, BLOCK, WAYS, POLICY_DRRIP);
+    unsigned int psel = cs.psel;
+    run_seq(&cs, 0, "ABCDEFGH", 1);
+    check(cs.psel == psel + 8, "SRRIP leader misses did not raise psel", POLICY_DRRIP);
+    run_seq(&cs, 0, "H", 1);
+    check(cs.psel == psel + 8, "a hit moved psel", POLICY_DRRIP);
+    run_seq(&cs, 1, "ABC", 1);
+    check(cs.psel == psel + 5, "BRRIP leader misses did not lower psel", POLICY_DRRIP);
+    for (int n = 1; n <= 2000; n++)
+        cache_access_block(&cs, block_addr(&cs, 0, n));
+    check(cs.psel == 1023, "psel does not saturate at 1023", POLICY_DRRIP);
+    cache_sim_free(&cs);
+
+    // 8 KB: 128 sets, leaders every 4th set (SRRIP at 0, BRRIP at 2), the
+    // rest follow psel. With SRRIP leaders missing most, a follower loop
+    // behaves like BRRIP; once BRRIP leaders miss most, like SRRIP
+    cache_sim_init(&cs, 8, BLOCK, WAYS, POLICY_DRRIP);
+    for (int n = 1; n <= 600; n++)
+        cache_access_block(&cs, block_addr(&cs, 0, n));
+    check(cs.psel >= 512, "psel below the middle after SRRIP leader misses", POLICY_DRRIP);
+    check(run_seq(&cs, 1, "ABCDE", 100) >= loop / 2, "follower did not use BRRIP",
+          POLICY_DRRIP);
+    for (int n = 1; n <= 1200; n++)
+        cache_access_block(&cs, block_addr(&cs, 2, n));
+    check(cs.psel < 512, "psel above the middle after BRRIP leader misses", POLICY_DRRIP);
+    check(run_seq(&cs, 3, "ABCDE", 100) == 0, "follower did not use SRRIP", POLICY_DRRIP);
+    cache_sim_free(&cs);
+
+    printf("%s test_rrip\n", failures ? "FAIL" : "ok  ");
+    return failures != 0;
+}
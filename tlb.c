@@ -0,0 +1,178 @@
+#include "tlb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int tlb_config_parse(const char *spec, TlbConfig *cfg) {
+    char buf[64];
+    if (strlen(spec) >= sizeof(buf)) return 0;
+    strcpy(buf, spec);
+
+    TlbConfig out = *cfg;
+    int field = 0;
+    for (char *tok = strtok(buf, ":"); tok; tok = strtok(NULL, ":"), field++) {
+        char *end;
+        if (field == 2) {
+            if (!cache_policy_parse(tok, &out.policy)) return 0;
+            continue;
+        }
+        long v = strtol(tok, &end, 10);
+        if (*end != '\0' || v < 0) return 0;
+        switch (field) {
+        case 0: out.entries = (int)v; break;
+        case 1: out.associativity = (int)v; break;
+        case 3: out.latency = (int)v; break;
+        default: return 0;
+        }
+    }
+    if (field < 2) return 0;
+
+    int e = out.entries;
+    int a = out.associativity;
+    if (e < 1 || e > 65536 || (e & (e - 1))) return 0;
+    if (a < 1 || a > TLB_MAX_WAYS || a > e || (a & (a - 1))) return 0;
+    if (out.policy != POLICY_RR && out.policy != POLICY_RND && out.policy != POLICY_LRU)
+        return 0;
+    *cfg = out;
+    return 1;
+}
+
+static void tlb_level_init(TlbLevel *lv, const TlbConfig *cfg) {
+    size_t n = (size_t)cfg->entries;
+    lv->cfg = *cfg;
+    lv->num_sets = cfg->entries / cfg->associativity;
+    lv->keys = (uint64_t *)calloc(n, sizeof(uint64_t));
+    lv->ppns = (uint32_t *)calloc(n, sizeof(uint32_t));
+    lv->stamps = (uint64_t *)calloc(n, sizeof(uint64_t));
+    if (!lv->keys || !lv->ppns || !lv->stamps) {
+        fprintf(stderr, "Error: tlb_init out of memory.\n");
+        exit(1);
+    }
+    lv->clock = 0;
+    lv->lookups = lv->hits = 0;
+}
+
+void tlb_init(Tlb *tlb, const TlbConfig *l1, const TlbConfig *l2, int walk_cycles) {
+    memset(tlb, 0, sizeof(*tlb));
+    tlb_level_init(&tlb->level[0], l1);
+    tlb->num_levels = 1;
+    if (l2) {
+        tlb_level_init(&tlb->level[1], l2);
+        tlb->num_levels = 2;
+    }
+    tlb->walk_cycles = walk_cycles;
+    tlb->rng_state = 0x9E3779B97F4A7C15ULL;
+}
+
+void tlb_free(Tlb *tlb) {
+    for (int l = 0; l < tlb->num_levels; l++) {
+        free(tlb->level[l].keys);
+        free(tlb->level[l].ppns);
+        free(tlb->level[l].stamps);
+    }
+    tlb->num_levels = 0;
+}
+
+static uint64_t tlb_key(int asid, unsigned long long vpn) {
+    return (((uint64_t)(uint32_t)asid << 32) | (uint64_t)(uint32_t)vpn) + 1ULL;
+}
+
+// First entry of key's set
+static size_t tlb_set_base(const TlbLevel *lv, uint64_t key) {
+    // hash the ASID in so processes with the same VPNs spread over sets
+    uint64_t h = (key - 1ULL) ^ ((key - 1ULL) >> 32) * 0x9E3779B1ULL;
+    return (size_t)(h & (uint64_t)(lv->num_sets - 1)) * (size_t)lv->cfg.associativity;
+}
+
+// Slot holding key, -1 if absent
+static long tlb_level_find(TlbLevel *lv, uint64_t key, size_t base) {
+    for (int w = 0; w < lv->cfg.associativity; w++) {
+        if (lv->keys[base + (size_t)w] == key)
+            return (long)(base + (size_t)w);
+    }
+    return -1;
+}
+
+static void tlb_level_fill(Tlb *tlb, TlbLevel *lv, uint64_t key, uint32_t ppn) {
+    size_t base = tlb_set_base(lv, key);
+    int ways = lv->cfg.associativity;
+    if (tlb_level_find(lv, key, base) >= 0)
+        return;
+
+    // empty slot first, else the policy's victim
+    size_t victim = base;
+    int found_empty = 0;
+    for (int w = 0; w < ways; w++) {
+        if (lv->keys[base + (size_t)w] == 0) {
+            victim = base + (size_t)w;
+            found_empty = 1;
+            break;
+        }
+    }
+    if (!found_empty) {
+        if (lv->cfg.policy == POLICY_RND) {
+            unsigned long long x = tlb->rng_state;
+            x ^= x >> 12;
+            x ^= x << 25;
+            x ^= x >> 27;
+            tlb->rng_state = x;
+            victim = base + (size_t)((x * 0x2545F4914F6CDD1DULL) >> 32) % (size_t)ways;
+        } else {
+            // oldest stamp: least recently used (LRU) or first in (RR)
+            for (int w = 1; w < ways; w++) {
+                if (lv->stamps[base + (size_t)w] < lv->stamps[victim])
+                    victim = base + (size_t)w;
+            }
+        }
+    }
+    lv->keys[victim] = key;
+    lv->ppns[victim] = ppn;
+    lv->stamps[victim] = ++lv->clock;
+}
+
+long tlb_lookup(Tlb *tlb, int asid, unsigned long long vpn) {
+    uint64_t key = tlb_key(asid, vpn);
+    for (int l = 0; l < tlb->num_levels; l++) {
+        TlbLevel *lv = &tlb->level[l];
+        lv->lookups++;
+        tlb->cycles += (unsigned long long)lv->cfg.latency;
+        long slot = tlb_level_find(lv, key, tlb_set_base(lv, key));
+        if (slot < 0)
+            continue;
+
+        lv->hits++;
+        if (lv->cfg.policy == POLICY_LRU)
+            lv->stamps[slot] = ++lv->clock;
+        uint32_t ppn = lv->ppns[slot];
+        for (int u = 0; u < l; u++)
+            tlb_level_fill(tlb, &tlb->level[u], key, ppn);
+        return (long)ppn;
+    }
+    tlb->walks++;
+    tlb->cycles += (unsigned long long)tlb->walk_cycles;
+    return -1;
+}
+
+void tlb_fill(Tlb *tlb, int asid, unsigned long long vpn, unsigned long long ppn) {
+    uint64_t key = tlb_key(asid, vpn);
+    for (int l = 0; l < tlb->num_levels; l++)
+        tlb_level_fill(tlb, &tlb->level[l], key, (uint32_t)ppn);
+}
+
+void tlb_invalidate(Tlb *tlb, int asid, unsigned long long vpn) {
+    uint64_t key = tlb_key(asid, vpn);
+    for (int l = 0; l < tlb->num_levels; l++) {
+        TlbLevel *lv = &tlb->level[l];
+        long slot = tlb_level_find(lv, key, tlb_set_base(lv, key));
+        if (slot >= 0)
+            lv->keys[slot] = 0;
+    }
+}
+
+void tlb_flush(Tlb *tlb) {
+    for (int l = 0; l < tlb->num_levels; l++) {
+        TlbLevel *lv = &tlb->level[l];
+        memset(lv->keys, 0, (size_t)lv->cfg.entries * sizeof(uint64_t));
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdint.h>
+
+#include "cachesim.h"
+
+// TRANSLATION LOOKASIDE BUFFERS in front of the page tables
+//
+// An L1 TLB and an optional L2 TLB, each set associative over
+// (ASID, VPN) with one ASID per trace, so processes share the TLB without
+// flushes. A lookup costs the L1 latency, an L1 miss adds the L2 latency
+// and an L2 miss adds a page walk. Only mapped pages are ever filled, so a
+// hit also stands in for the page-table lookup.
+
+#define TLB_MAX_WAYS 64
+
+typedef struct {
+    int entries;
+    int associativity;
+    ReplacementPolicy policy;    // rr, rnd or lru
+    int latency;                 // cycles per lookup at this level
+} TlbConfig;
+
+typedef struct {
+    TlbConfig cfg;
+    int num_sets;
+    uint64_t *keys;              // [num_sets * ways], (asid:vpn) + 1, 0 = empty
+    uint32_t *ppns;
+    uint64_t *stamps;            // LRU: last use; RR: insertion order
+    uint64_t clock;              // per fill or hit; 64-bit so it never wraps
+
+    unsigned long long lookups;
+    unsigned long long hits;
+} TlbLevel;
+
+typedef struct Tlb Tlb;
+struct Tlb {
+    TlbLevel level[2];
+    int num_levels;
+    int walk_cycles;             // page walk after a miss in every level
+    unsigned long long rng_state;
+
+    unsigned long long walks;
+    unsigned long long cycles;   // translation cycles, added to CPI
+};
+
+// "entries:assoc[:policy[:latency]]", e.g. "64:4:lru:0". Fields left out
+// keep their value in *cfg. Returns 1 if OK, 0 if malformed
+int tlb_config_parse(const char *spec, TlbConfig *cfg);
+
+// l2 may be NULL for a single-level TLB
+void tlb_init(Tlb *tlb, const TlbConfig *l1, const TlbConfig *l2, int walk_cycles);
+void tlb_free(Tlb *tlb);
+
+// PPN of (asid, vpn), or -1 on a miss in every level (the walk is charged)
+long tlb_lookup(Tlb *tlb, int asid, unsigned long long vpn);
+// Install a mapping after a page walk, in every level
+void tlb_fill(Tlb *tlb, int asid, unsigned long long vpn, unsigned long long ppn);
+// Drop a mapping from every level (the page was unmapped)
+void tlb_invalidate(Tlb *tlb, int asid, unsigned long long vpn);
+// Drop every mapping (context switch without ASIDs)
+void tlb_flush(Tlb *tlb);
+
+#endif
@@ -0,0 +1,68 @@
+// trc2bin: convert a text .trc trace into the binary trace format of
+// trace.h, so repeated simulations can stream it without re-parsing.
+//
+// usage: trc2bin <input.trc | -> <output.bin | ->
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+#define BATCH 4096
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        printf("Usage: trc2bin <input.trc | -> <output.bin | ->\n");
+        return 1;
+    }
+
+    TraceReader tr;
+    if (!trace_open(&tr, argv[1])) {
+        fprintf(stderr, "Error: cannot open %s.\n", argv[1]);
+        return 1;
+    }
+
+    int to_stdout = (strcmp(argv[2], "-") == 0);
+    FILE* out = to_stdout ? stdout : fopen(argv[2], "wb");
+    if (!out) {
+        fprintf(stderr, "Error: cannot create %s.\n", argv[2]);
+        trace_close(&tr);
+        return 1;
+    }
+
+    // record count is patched in afterwards when the output is seekable
+    TraceBinHeader hdr;
+    trace_bin_header(&hdr, 0);
+    int ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+
+    static TraceBinRecord batch[BATCH];
+    unsigned long long count = 0;
+    size_t n = 0;
+    TraceRecord rec;
+    while (ok && trace_next(&tr, &rec)) {
+        trace_bin_encode(&rec, &batch[n++]);
+        count++;
+        if (n == BATCH) {
+            ok = fwrite(batch, sizeof(batch[0]), n, out) == n;
+            n = 0;
+        }
+    }
+    if (ok && n > 0)
+        ok = fwrite(batch, sizeof(batch[0]), n, out) == n;
+
+    if (ok && !to_stdout && fseek(out, 0, SEEK_SET) == 0) {
+        trace_bin_header(&hdr, count);
+        ok = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+    }
+    if (fflush(out) != 0) ok = 0;
+    if (!to_stdout) fclose(out);
+    trace_close(&tr);
+
+    if (!ok) {
+        fprintf(stderr, "Error: write to %s failed.\n", argv[2]);
+        return 1;
+    }
+    fprintf(stderr, "%s: %llu records -> %s (%llu bytes)\n", argv[1], count, argv[2],
+            (unsigned long long)(sizeof(hdr) + count * sizeof(TraceBinRecord)));
+    return 0;
+}
@@ -0,0 +1,544 @@
+#include "trace.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TRACE_BUF_SIZE (1 << 20)   // buffered backend read size
+
+// SPAN HELPERS (bounded replacements for strstr/strtoull/atoi)
+
+// Find needle in [p, end), NULL if absent
+static const char* span_find(const char* p, const char* end, const char* needle) {
+    size_t nlen = strlen(needle);
+    while ((size_t)(end - p) >= nlen) {
+        const char* hit = (const char*)memchr(p, needle[0], (size_t)(end - p) - nlen + 1);
+        if (!hit) return NULL;
+        if (memcmp(hit, needle, nlen) == 0) return hit;
+        p = hit + 1;
+    }
+    return NULL;
+}
+
+static int hex_digit(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Same result as strtoull(str, NULL, 16) on the NUL terminated copy of [p, end)
+static unsigned long long span_strtoull16(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    int neg = 0;
+    if (p < end && (*p == '+' || *p == '-')) {
+        neg = (*p == '-');
+        p++;
+    }
+    if (end - p >= 3 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') &&
+        hex_digit((unsigned char)p[2]) >= 0)
+        p += 2;
+    unsigned long long val = 0;
+    int overflow = 0;
+    for (int d; p < end && (d = hex_digit((unsigned char)*p)) >= 0; p++) {
+        if (val >> 60) overflow = 1;
+        val = (val << 4) | (unsigned long long)d;
+    }
+    if (overflow) return ULLONG_MAX;
+    return neg ? (0ULL - val) : val;
+}
+
+// Same result as atoi() on the NUL terminated copy of [p, end)
+static int span_atoi(const char* p, const char* end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    int neg = 0;
+    if (p < end && (*p == '+' || *p == '-')) {
+        neg = (*p == '-');
+        p++;
+    }
+    int val = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        val = val * 10 + (*p - '0');
+    return neg ? -val : val;
+}
+
+// FAST FIXED-OFFSET PARSER
+//
+// The trace writer emits fixed columns:
+//   "EIP (LL): XXXXXXXX ..."
+//   "dstM: XXXXXXXX DDDDDDDD    srcM: XXXXXXXX DDDDDDDD"
+// where DDDDDDDD is the data value or "--------" when the operand is unused.
+// Lines matching that layout are decoded straight from their columns; any
+// other line falls back to the tolerant parsers below.
+
+#define ONES 0x0101010101010101ULL
+#define HIGH 0x8080808080808080ULL
+
+// high bit of every byte of x that lies in [lo, hi], for bytes < 0x80
+#define SWAR_IN_RANGE(x, lo, hi) \
+    (((x) + (0x80 - (lo)) * ONES) & ~((x) + (0x7F - (hi)) * ONES) & HIGH)
+
+static uint64_t load8(const char* p) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+// Decode 8 ASCII hex digits at p, branch free. Returns 0 if any byte
+// is not a hex digit, else 1 with the 32-bit value in *out
+static int hex8_decode(const char* p, uint32_t* out) {
+    uint64_t x = load8(p);
+    uint64_t ok = SWAR_IN_RANGE(x, 0x30, 0x39) |   // 0-9
+                  SWAR_IN_RANGE(x, 0x41, 0x46) |   // A-F
+                  SWAR_IN_RANGE(x, 0x61, 0x66);    // a-f
+    ok &= ~x;                                      // reject bytes >= 0x80
+
+    // nibble per byte: low 4 bits, +9 for letters (bit 6 set)
+    uint64_t v = (x & 0x0F0F0F0F0F0F0F0FULL) + ((x & 0x4040404040404040ULL) >> 6) * 9;
+    // first character is the most significant digit and sits in the low byte
+    v = ((v << 4) + (v >> 8)) & 0x00FF00FF00FF00FFULL;
+    v = ((v << 8) + (v >> 16)) & 0x0000FFFF0000FFFFULL;
+    v = ((v << 16) + (v >> 32)) & 0x00000000FFFFFFFFULL;
+
+    *out = (uint32_t)v;
+    return ok == HIGH;
+}
+
+static int is_line_end(const char* p, const char* end) {
+    return p == end || *p == '\n' || *p == '\r';
+}
+
+// only blanks may follow the last fixed column
+static int rest_blank(const char* p, const char* end) {
+    for (; p < end; p++) {
+        if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') return 0;
+    }
+    return 1;
+}
+
+// Fixed-layout EIP line. Returns 1 if decoded, 0 if the line must go
+// through parse_eip_line() instead
+int parse_eip_fast(const char* line, size_t n, unsigned long long* addr, int* len) {
+    uint32_t val;
+    if (n < 18 || memcmp(line, "EIP (", 5) != 0 || memcmp(line + 7, "): ", 3) != 0)
+        return 0;
+    unsigned d0 = (unsigned)(line[5] - '0'), d1 = (unsigned)(line[6] - '0');
+    if ((d0 | d1) > 9 || !hex8_decode(line + 10, &val) || val > 0x7FFFFFFF)
+        return 0;
+    if (n > 18 && line[18] != ' ' && !is_line_end(line + 18, line + n))
+        return 0;
+    *len = (int)(d0 * 10 + d1);
+    *addr = val;
+    return 1;
+}
+
+// Fixed-layout dstM/srcM line. Returns 1 if decoded, 0 if the line must
+// go through parse_dst_src_line() instead
+int parse_dst_src_fast(const char* line, size_t n,
+                       unsigned long long* dst_addr, int* dst_valid,
+                       unsigned long long* src_addr, int* src_valid) {
+    uint32_t dst, src, data;
+    if (n < 50 || memcmp(line, "dstM: ", 6) != 0 || line[14] != ' ' ||
+        memcmp(line + 23, "    srcM: ", 10) != 0 || line[41] != ' ' ||
+        !rest_blank(line + 50, line + n))
+        return 0;
+    if (!hex8_decode(line + 6, &dst) || !hex8_decode(line + 33, &src))
+        return 0;
+
+    // data column: a value means the operand is used, dashes mean unused
+    int dst_used = hex8_decode(line + 15, &data);
+    if (!dst_used && memcmp(line + 15, "--------", 8) != 0)
+        return 0;
+    int src_used = hex8_decode(line + 42, &data);
+    if (!src_used && memcmp(line + 42, "--------", 8) != 0)
+        return 0;
+
+    *dst_valid = dst_used && dst <= 0x7FFFFFFF;
+    *dst_addr = *dst_valid ? dst : 0;
+    *src_valid = src_used && src <= 0x7FFFFFFF;
+    *src_addr = *src_valid ? src : 0;
+    return 1;
+}
+
+// TRACE PARSING HELPERS
+
+// Parse EIP line
+int parse_eip_line(const char* line, size_t n, unsigned long long* addr, int* len) {
+    if (n < 3 || strncmp(line, "EIP", 3) != 0) return 0;
+
+    const char* end = line + n;
+    const char* len_end = (n > 7) ? line + 7 : end;
+    *len = (n > 5) ? span_atoi(line + 5, len_end) : 0;
+
+    const char* addr_end = (n > 18) ? line + 18 : end;
+    unsigned long long val = (n > 10) ? span_strtoull16(line + 10, addr_end) : 0;
+    if (val > 0x7FFFFFFF) return 0;
+    *addr = val;
+
+    return 1;
+}
+
+// Parse dst/src memory line
+int parse_dst_src_line(const char* line, size_t n,
+                       unsigned long long* dst_addr, int* dst_valid,
+                       unsigned long long* src_addr, int* src_valid) {
+    const char* end = line + n;
+    const char* p;
+    *dst_addr = *src_addr = 0;
+    *dst_valid = *src_valid = 0;
+
+    // dstM
+    p = span_find(line, end, "dstM:");
+    if (p) {
+        p += 5;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        const char* field_end = span_find(p, end, "srcM:");
+        if (!field_end) field_end = end;
+        if (field_end - p > 63) field_end = p + 63;
+
+        if (!span_find(p, field_end, "--------")) {
+            unsigned long long val = span_strtoull16(p, field_end);
+            if (val <= 0x7FFFFFFF) {
+                *dst_addr = val;
+                *dst_valid = 1;
+            }
+        }
+    }
+
+    // srcM
+    p = span_find(line, end, "srcM:");
+    if (p) {
+        p += 5;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        const char* field_end = (end - p > 63) ? p + 63 : end;
+
+        if (!span_find(p, field_end, "--------")) {
+            unsigned long long val = span_strtoull16(p, field_end);
+            if (val <= 0x7FFFFFFF) {
+                *src_addr = val;
+                *src_valid = 1;
+            }
+        }
+    }
+
+    return 1;
+}
+
+// BINARY TRACE FORMAT
+
+// The file is little endian: these convert between it and the host, both
+// ways (a no-op on little-endian hosts)
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static uint32_t le32(uint32_t v) { return __builtin_bswap32(v); }
+static uint64_t le64(uint64_t v) { return __builtin_bswap64(v); }
+#else
+static uint32_t le32(uint32_t v) { return v; }
+static uint64_t le64(uint64_t v) { return v; }
+#endif
+
+void trace_bin_header(TraceBinHeader* hdr, uint64_t record_count) {
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, TRACE_BIN_MAGIC, sizeof(hdr->magic));
+    hdr->version = le32(TRACE_BIN_VERSION);
+    hdr->record_size = le32((uint32_t)sizeof(TraceBinRecord));
+    hdr->record_count = le64(record_count);
+}
+
+void trace_bin_encode(const TraceRecord* rec, TraceBinRecord* out) {
+    // parsers only accept addresses <= 0x7FFFFFFF, so 32 bits are enough
+    out->eip = le32((uint32_t)rec->eip);
+    out->dst = le32(rec->dst_valid ? (uint32_t)rec->dst : 0);
+    out->src = le32(rec->src_valid ? (uint32_t)rec->src : 0);
+    out->len = (uint8_t)rec->len;
+    out->flags = (uint8_t)((rec->dst_valid ? TRACE_BIN_DST_VALID : 0) |
+                           (rec->src_valid ? TRACE_BIN_SRC_VALID : 0));
+    out->reserved = 0;
+}
+
+// TRACE READER
+
+// Buffered backend: slide the unread tail down and read the next block
+static int trace_refill(TraceReader* tr) {
+    size_t left = (size_t)(tr->end - tr->cur);
+    if (left == tr->buf_cap) {
+        // a single line longer than the buffer, grow it
+        char* tmp = (char*)realloc(tr->buf, tr->buf_cap * 2);
+        if (!tmp) {
+            fprintf(stderr, "Error: Memory allocation failed in trace_refill.\n");
+            exit(1);
+        }
+        tr->cur = tmp + (tr->cur - tr->buf);
+        tr->buf = tmp;
+        tr->buf_cap *= 2;
+    }
+    memmove(tr->buf, tr->cur, left);
+    PROFILE_BEGIN(t);
+    size_t got = fread(tr->buf + left, 1, tr->buf_cap - left, tr->fp);
+    PROFILE_END(PROFILE_READ, t, got);
+    if (got == 0) tr->eof = 1;
+    tr->cur = tr->buf;
+    tr->end = tr->buf + left + got;
+    return got > 0;
+}
+
+// Make at least n bytes available in the window if the trace has them
+static int trace_want(TraceReader* tr, size_t n) {
+    while ((size_t)(tr->end - tr->cur) < n) {
+        if (tr->backend == TRACE_MMAP || tr->eof)
+            return 0;
+        trace_refill(tr);
+    }
+    return 1;
+}
+
+// Size of the trace file in bytes. Returns 0 if it is not known (stdin,
+// a pipe)
+static int trace_file_size(const TraceReader* tr, uint64_t* size) {
+    if (tr->backend == TRACE_MMAP) {
+        *size = tr->map_len;
+        return 1;
+    }
+#ifndef _WIN32
+    struct stat st;
+    if (tr->fp != stdin && fstat(fileno(tr->fp), &st) == 0 && S_ISREG(st.st_mode)) {
+        *size = (uint64_t)st.st_size;
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+// Switch to binary records if the trace starts with a trc2bin header.
+// Returns 0 if the header is there but unusable
+static int trace_detect_binary(TraceReader* tr) {
+    TraceBinHeader hdr;
+    if (!trace_want(tr, sizeof(hdr)) ||
+        memcmp(tr->cur, TRACE_BIN_MAGIC, sizeof(hdr.magic)) != 0)
+        return 1; // text trace
+
+    memcpy(&hdr, tr->cur, sizeof(hdr));
+    uint32_t version = le32(hdr.version);
+    uint64_t count = le64(hdr.record_count);
+    if (version != TRACE_BIN_VERSION ||
+        le32(hdr.record_size) != sizeof(TraceBinRecord)) {
+        fprintf(stderr, "Error: %s: unsupported binary trace version %u.\n",
+                tr->name, (unsigned)version);
+        return 0;
+    }
+    // a known count must account for the whole file: a short or padded
+    // file was cut off or is not a trc2bin trace
+    uint64_t size;
+    if (count != 0 && trace_file_size(tr, &size) &&
+        ((size - sizeof(hdr)) % sizeof(TraceBinRecord) != 0 ||
+         (size - sizeof(hdr)) / sizeof(TraceBinRecord) != count)) {
+        fprintf(stderr, "Error: %s: binary trace holds %llu bytes of records, "
+                        "its header says %llu records.\n",
+                tr->name, (unsigned long long)(size - sizeof(hdr)),
+                (unsigned long long)count);
+        return 0;
+    }
+    tr->binary = 1;
+    tr->cur += sizeof(hdr);
+    return 1;
+}
+
+static int trace_open_buffered(TraceReader* tr, const char* path) {
+    tr->backend = TRACE_BUFFERED;
+    tr->fp = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (!tr->fp) return 0;
+    tr->buf_cap = TRACE_BUF_SIZE;
+    tr->buf = (char*)malloc(tr->buf_cap);
+    if (!tr->buf) {
+        fprintf(stderr, "Error: Memory allocation failed in trace_open.\n");
+        exit(1);
+    }
+    tr->cur = tr->end = tr->buf;
+    return 1;
+}
+
+static int trace_open_backend(TraceReader* tr, const char* path) {
+#ifndef _WIN32
+    if (strcmp(path, "-") != 0) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return 0;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            tr->backend = TRACE_MMAP;
+            tr->map_len = (size_t)st.st_size;
+            if (tr->map_len == 0) {
+                close(fd);
+                return 1; // empty trace, nothing to walk
+            }
+            void* map = mmap(NULL, tr->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+                madvise(map, tr->map_len, MADV_SEQUENTIAL);
+#endif
+                tr->map = map;
+                tr->cur = (const char*)map;
+                tr->end = tr->cur + tr->map_len;
+                return 1;
+            }
+            tr->map_len = 0;
+        } else {
+            close(fd);
+        }
+    }
+#endif
+
+    return trace_open_buffered(tr, path);
+}
+
+int trace_open(TraceReader* tr, const char* path) {
+    PROFILE_BEGIN(t);
+    memset(tr, 0, sizeof(*tr));
+    tr->name = path;
+
+    int ok = trace_open_backend(tr, path);
+    if (ok && !trace_detect_binary(tr)) {
+        trace_close(tr);
+        ok = 0;
+    }
+    PROFILE_END(PROFILE_READ, t, 0);
+    return ok;
+}
+
+void trace_close(TraceReader* tr) {
+#ifndef _WIN32
+    if (tr->map)
+        munmap(tr->map, tr->map_len);
+#endif
+    if (tr->fp && tr->fp != stdin)
+        fclose(tr->fp);
+    free(tr->buf);
+    memset(tr, 0, sizeof(*tr));
+}
+
+// Hand out the next line as a span including its '\n' (like fgets)
+static int trace_next_line(TraceReader* tr, const char** line, size_t* n) {
+    for (;;) {
+        size_t avail = (size_t)(tr->end - tr->cur);
+        const char* nl = avail ? (const char*)memchr(tr->cur, '\n', avail) : NULL;
+        if (nl || tr->backend == TRACE_MMAP || tr->eof) {
+            if (avail == 0) return 0;
+            *line = tr->cur;
+            *n = nl ? (size_t)(nl - tr->cur) + 1 : avail;
+            tr->cur += *n;
+            return 1;
+        }
+        trace_refill(tr);
+    }
+}
+
+// Next fixed-size record of a binary trace, a truncated tail is ignored
+static int trace_next_bin(TraceReader* tr, TraceRecord* rec) {
+    TraceBinRecord r;
+    if (!trace_want(tr, sizeof(r)))
+        return 0;
+    memcpy(&r, tr->cur, sizeof(r));
+    tr->cur += sizeof(r);
+
+    rec->eip = le32(r.eip);
+    rec->len = r.len;
+    rec->dst = le32(r.dst);
+    rec->src = le32(r.src);
+    rec->dst_valid = (r.flags & TRACE_BIN_DST_VALID) != 0;
+    rec->src_valid = (r.flags & TRACE_BIN_SRC_VALID) != 0;
+    return 1;
+}
+
+static int line_blank(const char* line) {
+    return line[0] == '\n' || line[0] == '\r' || line[0] == '\0';
+}
+
+int trace_next(TraceReader* tr, TraceRecord* rec) {
+    const char *line1, *line2;
+    size_t n1, n2;
+
+    if (tr->binary)
+        return trace_next_bin(tr, rec);
+
+    while (trace_next_line(tr, &line1, &n1)) {
+        if (line_blank(line1))
+            continue;
+
+        if (!parse_eip_fast(line1, n1, &rec->eip, &rec->len) &&
+            !parse_eip_line(line1, n1, &rec->eip, &rec->len)) {
+            fprintf(stderr, "Warning: invalid EIP line: %.*s", (int)n1, line1);
+            continue;
+        }
+
+        if (!trace_next_line(tr, &line2, &n2))
+            return 0;
+        if (line_blank(line2))
+            continue;
+
+        if (!parse_dst_src_fast(line2, n2, &rec->dst, &rec->dst_valid,
+                                &rec->src, &rec->src_valid))
+            parse_dst_src_line(line2, n2, &rec->dst, &rec->dst_valid,
+                               &rec->src, &rec->src_valid);
+        return 1;
+    }
+    return 0;
+}
+
+// PROCESS TRACES
+
+void trace_set_init(TraceSet* ts, char** names, int count) {
+    ts->count = count;
+    ts->names = names;
+    ts->readers = (TraceReader*)calloc((size_t)count, sizeof(TraceReader));
+    ts->state = (TraceState*)calloc((size_t)count, sizeof(TraceState));
+    if (!ts->readers || !ts->state) {
+        fprintf(stderr, "Error: Memory allocation failed in trace_set_init.\n");
+        exit(1);
+    }
+}
+
+void trace_set_free(TraceSet* ts) {
+    for (int i = 0; i < ts->count; i++)
+        trace_set_end(ts, i);
+    free(ts->readers);
+    free(ts->state);
+    ts->readers = NULL;
+    ts->state = NULL;
+}
+
+TraceReader* trace_set_reader(TraceSet* ts, int i) {
+    if (ts->state[i] == TRACE_PENDING) {
+        if (trace_open(&ts->readers[i], ts->names[i])) {
+            ts->state[i] = TRACE_OPEN;
+        } else {
+            fprintf(stderr, "Warning: cannot open %s — skipping this file.\n",
+                    ts->names[i]);
+            ts->state[i] = TRACE_FAILED;
+        }
+    }
+    return (ts->state[i] == TRACE_OPEN) ? &ts->readers[i] : NULL;
+}
+
+void trace_set_end(TraceSet* ts, int i) {
+    if (ts->state[i] == TRACE_OPEN)
+        trace_close(&ts->readers[i]);
+    if (ts->state[i] != TRACE_FAILED)
+        ts->state[i] = TRACE_ENDED;
+}
+
+int trace_set_live(const TraceSet* ts, int i) {
+    return ts->state[i] == TRACE_PENDING || ts->state[i] == TRACE_OPEN;
+}
@@ -0,0 +1,129 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// One decoded instruction of a .trc file (an EIP line + its dstM/srcM line)
+typedef struct {
+    unsigned long long eip;    // instruction virtual address
+    int len;                   // instruction length in bytes
+    unsigned long long dst;    // dstM virtual address
+    unsigned long long src;    // srcM virtual address
+    int dst_valid;
+    int src_valid;
+} TraceRecord;
+
+// BINARY TRACE FORMAT (written by trc2bin, read transparently by -f)
+//
+// A TraceBinHeader followed by fixed-size TraceBinRecords, little endian
+// on every host (trace_bin_header/trace_bin_encode write that, the reader
+// swaps on big-endian hosts). Records are 16-byte aligned so a mapped file
+// can be walked directly. A nonzero record_count must match the file size.
+
+#define TRACE_BIN_MAGIC "VMCTRACE"
+#define TRACE_BIN_VERSION 1
+
+#define TRACE_BIN_DST_VALID 0x01
+#define TRACE_BIN_SRC_VALID 0x02
+
+typedef struct {
+    char magic[8];             // TRACE_BIN_MAGIC, not NUL terminated
+    uint32_t version;          // TRACE_BIN_VERSION
+    uint32_t record_size;      // sizeof(TraceBinRecord)
+    uint64_t record_count;     // 0 if unknown (written to a pipe)
+    uint64_t reserved;
+} TraceBinHeader;
+
+typedef struct {
+    uint32_t eip;
+    uint32_t dst;              // 0 unless TRACE_BIN_DST_VALID
+    uint32_t src;              // 0 unless TRACE_BIN_SRC_VALID
+    uint8_t len;
+    uint8_t flags;             // TRACE_BIN_* bits
+    uint16_t reserved;
+} TraceBinRecord;
+
+void trace_bin_header(TraceBinHeader* hdr, uint64_t record_count);
+void trace_bin_encode(const TraceRecord* rec, TraceBinRecord* out);
+
+typedef enum {
+    TRACE_MMAP = 0,            // whole file mapped, walked in place
+    TRACE_BUFFERED = 1         // stdin / pipes / no mmap: block reads
+} TraceBackend;
+
+typedef struct {
+    TraceBackend backend;
+    const char* name;
+    int binary;                // 1 for a trc2bin file, 0 for text
+
+    // current window: lines are handed out as [cur, newline] spans,
+    // binary records as TraceBinRecord sized steps
+    const char* cur;
+    const char* end;
+
+    // TRACE_MMAP
+    void* map;
+    size_t map_len;
+
+    // TRACE_BUFFERED
+    FILE* fp;
+    char* buf;
+    size_t buf_cap;
+    int eof;
+} TraceReader;
+
+// Open a text or binary trace file, "-" reads stdin. Returns 1 if OK,
+// 0 on failure
+int trace_open(TraceReader* tr, const char* path);
+void trace_close(TraceReader* tr);
+
+// Next instruction record. Returns 1 if one was produced, 0 at end of trace
+int trace_next(TraceReader* tr, TraceRecord* rec);
+
+// PROCESS TRACES, one per -f file
+//
+// A trace is opened on its process's first turn and closed once it ends,
+// so a run over hundreds of processes only maps the ones still running
+// (all live ones under round robin, one at a time otherwise).
+
+typedef enum {
+    TRACE_PENDING = 0,         // not opened yet
+    TRACE_OPEN = 1,
+    TRACE_ENDED = 2,
+    TRACE_FAILED = 3           // could not be opened, skipped
+} TraceState;
+
+typedef struct {
+    int count;
+    char** names;
+    TraceReader* readers;
+    TraceState* state;
+} TraceSet;
+
+void trace_set_init(TraceSet* ts, char** names, int count);
+void trace_set_free(TraceSet* ts);
+
+// Reader of trace i, opened on first use. NULL once it ended or if it
+// cannot be opened (warned once)
+TraceReader* trace_set_reader(TraceSet* ts, int i);
+// Trace i is done (exhausted or cut off by -n): close it
+void trace_set_end(TraceSet* ts, int i);
+// 1 while trace i may still produce records
+int trace_set_live(const TraceSet* ts, int i);
+
+// Fixed-column fast path. Returns 0 when the line does not match the
+// standard layout and the tolerant parser below must be used
+int parse_eip_fast(const char* line, size_t n, unsigned long long* addr, int* len);
+int parse_dst_src_fast(const char* line, size_t n,
+                       unsigned long long* dst_addr, int* dst_valid,
+                       unsigned long long* src_addr, int* src_valid);
+
+// TRACE PARSING HELPERS, [line, line + n) need not be NUL terminated
+int parse_eip_line(const char* line, size_t n, unsigned long long* addr, int* len);
+int parse_dst_src_line(const char* line, size_t n,
+                       unsigned long long* dst_addr, int* dst_valid,
+                       unsigned long long* src_addr, int* src_valid);
+
+#endif
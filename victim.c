@@ -0,0 +1,87 @@
+#include "victim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void victim_init(VictimCache *vc, int entries) {
+    memset(vc, 0, sizeof(*vc));
+    vc->entries = entries;
+    vc->blocks = (unsigned long long *)calloc((size_t)entries, sizeof(unsigned long long));
+    vc->dirty = (uint8_t *)calloc((size_t)entries, sizeof(uint8_t));
+    vc->stamps = (uint64_t *)calloc((size_t)entries, sizeof(uint64_t));
+    if (!vc->blocks || !vc->dirty || !vc->stamps) {
+        fprintf(stderr, "Error: victim_init out of memory.\n");
+        exit(1);
+    }
+}
+
+void victim_free(VictimCache *vc) {
+    free(vc->blocks);
+    free(vc->dirty);
+    free(vc->stamps);
+    memset(vc, 0, sizeof(*vc));
+}
+
+static int victim_find(const VictimCache *vc, unsigned long long block) {
+    for (int e = 0; e < vc->entries; e++) {
+        if (vc->blocks[e] == block + 1)
+            return e;
+    }
+    return -1;
+}
+
+int victim_take(VictimCache *vc, unsigned long long block, int *dirty) {
+    int e = victim_find(vc, block);
+    if (e < 0)
+        return 0;
+    *dirty = vc->dirty[e];
+    vc->blocks[e] = 0;
+    vc->dirty[e] = 0;
+    vc->hits++;
+    return 1;
+}
+
+int victim_put(VictimCache *vc, unsigned long long block, int dirty) {
+    int e = victim_find(vc, block);
+    int pushed_dirty = 0;
+    if (e < 0) {
+        // an empty entry, else the least recently inserted
+        e = 0;
+        for (int i = 0; i < vc->entries; i++) {
+            if (vc->blocks[i] == 0) {
+                e = i;
+                break;
+            }
+            if (vc->stamps[i] < vc->stamps[e])
+                e = i;
+        }
+        pushed_dirty = vc->blocks[e] != 0 && vc->dirty[e];
+        vc->dirty[e] = 0;
+    }
+    vc->blocks[e] = block + 1;
+    vc->dirty[e] |= (uint8_t)(dirty != 0);
+    vc->stamps[e] = ++vc->clock;
+    return pushed_dirty;
+}
+
+int victim_drop(VictimCache *vc, unsigned long long block) {
+    int e = victim_find(vc, block);
+    if (e < 0)
+        return 0;
+    int was_dirty = vc->dirty[e];
+    vc->blocks[e] = 0;
+    vc->dirty[e] = 0;
+    return was_dirty;
+}
+
+int victim_flush(VictimCache *vc) {
+    int dirty = 0;
+    for (int e = 0; e < vc->entries; e++) {
+        if (vc->blocks[e] && vc->dirty[e])
+            dirty++;
+        vc->blocks[e] = 0;
+        vc->dirty[e] = 0;
+    }
+    return dirty;
+}
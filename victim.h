@@ -0,0 +1,41 @@
+#ifndef VICTIM_H
+#define VICTIM_H
+
+#include <stdint.h>
+
+// VICTIM CACHE behind one CacheSim (Jouppi)
+//
+// A few fully associative LRU entries that catch the blocks the main
+// cache evicts. A main-cache miss that finds its block here swaps it back
+// in for VICTIM_HIT_CYCLES instead of a memory fill; the block it
+// displaces takes its place. Dirty blocks stay dirty until they leave
+// the victim cache, which is when they are written back.
+
+#define VICTIM_MAX_ENTRIES 64
+#define VICTIM_HIT_CYCLES 2      // main cache lookup, then the victim cache
+
+typedef struct VictimCache VictimCache;
+struct VictimCache {
+    int entries;
+    unsigned long long *blocks;  // block number + 1, 0 = empty
+    uint8_t *dirty;
+    uint64_t *stamps;            // last insertion, for LRU
+    uint64_t clock;              // per insertion; 64-bit so it never wraps
+
+    unsigned long long hits;     // main-cache misses served from here
+};
+
+void victim_init(VictimCache *vc, int entries);
+void victim_free(VictimCache *vc);
+
+// Remove block if present. Returns 1 on a hit, with its dirty bit
+int victim_take(VictimCache *vc, unsigned long long block, int *dirty);
+// Insert a block evicted from the main cache. Returns 1 if this pushed
+// out a dirty block, which must be written back
+int victim_put(VictimCache *vc, unsigned long long block, int dirty);
+// Drop block if present (page flush). Returns 1 if it was dirty
+int victim_drop(VictimCache *vc, unsigned long long block);
+// Drop everything. Returns the number of dirty blocks dropped
+int victim_flush(VictimCache *vc);
+
+#endif